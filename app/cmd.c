@@ -63,13 +63,16 @@
 
 /* Private variables -------------------------------------- */
 
-static char commandList[5][100] =
+static char commandList[cmdInvalid][100] =
 {
     "help 'command' - print help for the specified 'command'",
-    "load 'type' 'addr' 'size/file' - Load file. Types: sd or serial",
+    "load 'type' 'addr' ['size/file'] ['baud'] - Types: sd, serial, frame, serial-delta, ymodem",
     "go '<core>' 'addr' 'arg0' 'arg1' - start application using core '<core>' at address 'addr'",
     "read 'addr'",
     "write 'addr' 'value'",
+    "bootstage - print boot stage timestamps and deltas in microseconds",
+    "cache - print block cache, read ahead and FAT window statistics",
+    "wipe 'partition' - erase SD card partition 'partition' (1 to 4)",
 };
 
 /* Private function prototypes ---------------------------- */
@@ -147,9 +150,48 @@ int32_t CmdInterpretCommand(void)
             CmdSize_t size = CmdParserGetSize(&ptr, &state);
             CMDASSERT(cmdLoad, state);
             SKIPWHITESPACES(ptr);
+
+            // Check for a transfer baudrate
+            uint32_t baudrate = 0;
+            if('\0' != *ptr)
+            {
+                baudrate = CmdParserGetData(&ptr, &state);
+                CMDASSERT(cmdLoad, state);
+                SKIPWHITESPACES(ptr);
+            }
+            CMDCHECKEND(cmdLoad,ptr);
+
+            LoaderSerialLoad((ptr_t)addr, (uint32_t)size, baudrate);
+        }
+        else if(type == cmdFrame || type == cmdSerialDelta)
+        {
+            // Size comes with the transfer, check for a transfer baudrate
+            uint32_t baudrate = 0;
+            if('\0' != *ptr)
+            {
+                baudrate = CmdParserGetData(&ptr, &state);
+                CMDASSERT(cmdLoad, state);
+                SKIPWHITESPACES(ptr);
+            }
+            CMDCHECKEND(cmdLoad,ptr);
+
+            LoaderFrameLoad((ptr_t)addr, baudrate, (type == cmdSerialDelta));
+        }
+        else if(type == cmdYmodem)
+        {
+            // Check for a file to save the transfer to
+            char file[64];
+            char *path = NULL;
+            if('\0' != *ptr)
+            {
+                CmdParserGetStr(&ptr, &state, file);
+                CMDASSERT(cmdLoad, state);
+                SKIPWHITESPACES(ptr);
+                path = file;
+            }
             CMDCHECKEND(cmdLoad,ptr);
 
-            LoaderSerialLoad((ptr_t)addr, (uint32_t)size);
+            LoaderYmodemLoad((ptr_t)addr, path);
         }
         else
         {
@@ -258,6 +300,33 @@ int32_t CmdInterpretCommand(void)
 
         break;
     }
+    case cmdBootstage:
+    {
+        CMDCHECKEND(cmdBootstage,ptr);
+
+        LoaderBootstage();
+
+        break;
+    }
+    case cmdCache:
+    {
+        CMDCHECKEND(cmdCache,ptr);
+
+        LoaderCacheStats();
+
+        break;
+    }
+    case cmdWipe:
+    {
+        CmdData_t partition = CmdParserGetData(&ptr, &state);
+        CMDASSERT(cmdWipe, state);
+        SKIPWHITESPACES(ptr);
+        CMDCHECKEND(cmdWipe,ptr);
+
+        LoaderWipe((uint32_t)partition);
+
+        break;
+    }
     default:
     {
         puts("Unknown command! Type help to see available commands\n");
@@ -26,13 +26,19 @@ typedef enum
     cmdGo,
     cmdRead,
     cmdWrite,
+    cmdBootstage,
+    cmdCache,
+    cmdWipe,
     cmdInvalid,
 }cmd_t;
 
 typedef enum
 {
     cmdSerial,
-    cmdSd
+    cmdSd,
+    cmdFrame,
+    cmdYmodem,
+    cmdSerialDelta
 }cmdLoadType_t;
 
 typedef cmd_t       CmdCommand_t;
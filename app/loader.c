@@ -11,7 +11,18 @@
 #include <misc.h>
 #include <helper.h>
 #include <serial.h>
+#include <uart.h>
 #include <fat32.h>
+#include <bcache.h>
+#include <mmc.h>
+#include <mmu.h>
+#include <bootstage.h>
+#include <delay.h>
+#include <gic.h>
+#include <xfer.h>
+#include <ymodem.h>
+#include <lz4.h>
+#include <string.h>
 
 
 /* Private types ------------------------------------------ */
@@ -23,6 +34,23 @@
 #define CPU_CORE_COUNT 0x1
 #endif
 
+#define LOADER_CONSOLE_UART		UART0
+#define LOADER_SYNC_CHAR		'S'	/* Host: ready to switch */
+#define LOADER_ACK_CHAR			'A'	/* Target: running at the new baudrate */
+#define LOADER_GO_CHAR			'G'	/* Host: data follows */
+#define LOADER_PROGRESS_MS		(100)	/* Progress bar refresh period */
+#define LOADER_PROGRESS_MARKS	(16)
+#define LOADER_PATH_MAX			(96)
+#define LOADER_SWITCH_MS		(5000)	/* Host handshake after a baudrate switch */
+#define LOADER_SERIAL_CHUNK		(0x1000)
+#define LOADER_SD				(0)
+#define LOADER_PART_TABLE		(0x01BE)	/* MBR partition entries, 16 bytes each */
+#define LOADER_PART_COUNT		(4)
+
+#if (BOOTSTAGE_DRAM_ADDR != LOADER_BOOTSTAGE_ADDR)
+#error "The bootstage table has to stay in the loader reserved memory"
+#endif
+
 
 /* Private macros ----------------------------------------- */
 
@@ -30,6 +58,8 @@
 
 /* Private variables -------------------------------------- */
 
+/* End of the detected DRAM, set by LoaderInit */
+static uint32_t LoaderDramEnd = 0;
 
 
 /* Private function prototypes ---------------------------- */
@@ -39,26 +69,164 @@
     extern int32_t StartCore(uint32_t core, void* startup);
 #endif
 
-uint32_t GetWord(void)
+/* Private functions -------------------------------------- */
+
+/* Wait for a handshake character until the deadline expires */
+static bool_t LoaderWaitChar(char c, const deadline_t* deadline)
 {
-    uint32_t shift = 0;
-    unsigned char c = 0;
-    uint32_t word = 0;
+    uint32_t lineStatus = 0;
+    uint8_t rx;
 
-    while(shift < 32)
+    while(!deadline_expired(deadline))
     {
-        c = getc();
-        word |= ((uint32_t)(c) << shift);
-        shift += 8;
+        if(UartRead(LOADER_CONSOLE_UART, &rx, 1, &lineStatus) == 1 && rx == (uint8_t)c)
+        {
+            return TRUE;
+        }
     }
-    return word;
+
+    return FALSE;
 }
 
+/* Switch the console for a transfer, restore receives the baudrate to go back
+ * to afterwards (0 when nothing changed) */
+static int32_t LoaderSwitchBaudrate(uint32_t baudrate, uint32_t* restore)
+{
+    uint32_t consoleBaudrate = UartGetBaudrate(LOADER_CONSOLE_UART);
 
-/* Private functions -------------------------------------- */
+    *restore = 0;
+    if(baudrate == 0 || baudrate == consoleBaudrate)
+    {
+        return E_OK;
+    }
+
+    char str[12];
+    puts("Switching to ");
+    puts(itoa((int32_t)baudrate, str, 10));
+    puts(" baud\n");
+
+    if(UartSetBaudrate(LOADER_CONSOLE_UART, baudrate) != E_OK)
+    {
+        puts("Unsupported baudrate\n");
+        return E_INVAL;
+    }
+    *restore = consoleBaudrate;
+
+    /* Handshake: the host keeps sending sync until it gets an ack, any
+     * garbage produced while both sides switched is discarded */
+    deadline_t deadline;
+    deadline_set_ms(&deadline, LOADER_SWITCH_MS);
+    bool_t synced = LoaderWaitChar(LOADER_SYNC_CHAR, &deadline);
+    if(synced)
+    {
+        (void)putc(LOADER_ACK_CHAR);
+        synced = LoaderWaitChar(LOADER_GO_CHAR, &deadline);
+    }
+
+    if(!synced)
+    {
+        /* No host at the new baudrate, go back to the console one */
+        (void)UartSetBaudrate(LOADER_CONSOLE_UART, consoleBaudrate);
+        *restore = 0;
+        puts("No handshake, console baudrate restored\n");
+        return E_AGAIN;
+    }
+
+    /* Drop the receive errors caused by the switch */
+    uint32_t switchErrors = 0;
+    uint8_t dummy;
+    (void)UartRead(LOADER_CONSOLE_UART, &dummy, 0, &switchErrors);
+
+    return E_OK;
+}
+
+static void LoaderRestoreBaudrate(uint32_t restore)
+{
+    if(restore != 0)
+    {
+        (void)UartSetBaudrate(LOADER_CONSOLE_UART, restore);
+        puts("Restored console baudrate\n");
+    }
+}
+
+static void LoaderPutStat(const char* name, uint32_t value)
+{
+    char str[12];
+
+    puts(name);
+    puts(itoa((int32_t)value, str, 10));
+}
+
+/* Room for a load at addr before it reaches the reserved memory or the end
+ * of DRAM, 0 inside the reserved memory or past DRAM */
+static uint32_t LoaderRoom(ptr_t addr)
+{
+    uint32_t start = (uint32_t)addr;
+    uint32_t end = ((start < LOADER_RESERVED_START) ? (LOADER_RESERVED_START) : (LoaderDramEnd));
+
+    if(start >= end || (start >= LOADER_RESERVED_START && start < LOADER_RESERVED_END))
+    {
+        return 0;
+    }
+
+    return (end - start);
+}
+
+/* Refuse loads of size bytes at addr that would overwrite the reserved memory */
+static int32_t LoaderCheckRange(ptr_t addr, uint32_t size)
+{
+    uint32_t room = LoaderRoom(addr);
+
+    if(room == 0 || size > room)
+    {
+        puts("Load overlaps the bootloader reserved memory\n");
+        return E_INVAL;
+    }
+
+    return E_OK;
+}
+
+static int32_t LoaderLz4Finish(lz4_stream_t* lz4, int32_t ret, uint32_t* size)
+{
+    if(ret == E_OK)
+    {
+        ret = lz4_stream_finish(lz4, size);
+    }
+
+    if(ret == E_NO_MEMORY)
+    {
+        puts("LZ4: output does not fit\n");
+    }
+    else if(ret != E_OK)
+    {
+        puts("LZ4: corrupted or truncated input\n");
+    }
+    else
+    {
+        LoaderPutStat("LZ4: decompressed to ", *size);
+        puts(" bytes\n");
+    }
+
+    return ret;
+}
+
+void LoaderInit(ulong_t dramEnd)
+{
+    LoaderDramEnd = (uint32_t)dramEnd;
+}
 
 void LoaderGo(ptr_t addr, uint32_t core, uint32_t arg0, uint32_t arg1)
 {
+    bootstage_mark("go");
+
+    // Hand off with interrupts masked and the uart back in polled mode
+    irq_disable();
+    UartDisableRxInterrupt(LOADER_CONSOLE_UART);
+    GicDisable();
+
+    // Hand off with MMU and caches disabled and all data in memory
+    mmu_disable();
+
 #if (CPU_CORE_COUNT == 1)
     void (*entry)(uint32_t, uint32_t);
     entry = (void*)addr;
@@ -116,16 +284,39 @@ int32_t LoaderRead(ptr_t addr, uint32_t *data)
     return E_OK;
 }
 
-int32_t LoaderSerialLoad(ptr_t addr, uint32_t size)
+int32_t LoaderSerialLoad(ptr_t addr, uint32_t size, uint32_t baudrate)
 {
-    uint32_t *dst = (uint32_t *)addr;
+    uint32_t restore;
+
+    if(LoaderCheckRange(addr, size) != E_OK)
+    {
+        return E_INVAL;
+    }
+
+    int32_t ret = LoaderSwitchBaudrate(baudrate, &restore);
+    if(ret != E_OK)
+    {
+        return ret;
+    }
+
+    uint8_t *dst = (uint8_t *)addr;
     uint32_t count = 0;
-    uint32_t per = (size >> 4);
+    uint32_t marks = 0;
+    uint32_t lineStatus = 0;
+    deadline_t progress;
+
+    /* The host always sends whole words */
+    size = (size + 3) & ~3;
+    uint32_t per = size / LOADER_PROGRESS_MARKS;
+    if(per == 0)
+    {
+        per = 1;
+    }
 
     (void)putc('0');
     (void)putc('%');
     (void)putc('[');
-    for(;count < 16; count++)
+    for(;count < LOADER_PROGRESS_MARKS; count++)
     {
         (void)putc(' ');
     }
@@ -139,33 +330,293 @@ int32_t LoaderSerialLoad(ptr_t addr, uint32_t size)
         (void)putc(ASCII_BS);
     }
 
-    uint32_t inc = 0;
     count = 0;
 
+    bootstage_mark("serial load start");
+
+    /* An LZ4 frame is decompressed into addr while it arrives */
+    lz4_stream_t lz4;
+    int32_t lz4Ret = E_OK;
+    uint32_t head = 0;
+    uint32_t headLen = min((uint32_t)4, size);
+    while(count < headLen)
+    {
+        count += UartRead(LOADER_CONSOLE_UART, &((uint8_t*)&head)[count], headLen - count, &lineStatus);
+    }
+
+    bool_t compressed = (headLen == 4 && lz4_is_frame(&head));
+    if(compressed)
+    {
+        lz4_stream_init(&lz4, dst, LoaderRoom(addr));
+        lz4Ret = lz4_stream_write(&lz4, &head, headLen);
+    }
+    else
+    {
+        memcpy(dst, &head, headLen);
+    }
+
+    /* Keep the receive loop free of console output, only update the progress
+     * bar every LOADER_PROGRESS_MS so the RX FIFO can not overrun */
+    deadline_set_ms(&progress, LOADER_PROGRESS_MS);
     while(size > count)
     {
-        *dst = GetWord();
-        dst++;
-        count += 4;
-        inc += 4;
+        if(compressed)
+        {
+            uint8_t *stage = (uint8_t *)LOADER_STAGE_ADDR;
+            uint32_t n = UartRead(LOADER_CONSOLE_UART, stage, min(size - count, (uint32_t)LOADER_SERIAL_CHUNK), &lineStatus);
+
+            /* Keep draining the line after an error so the host can finish */
+            if(n != 0 && lz4Ret == E_OK)
+            {
+                lz4Ret = lz4_stream_write(&lz4, stage, n);
+            }
+            count += n;
+        }
+        else
+        {
+            count += UartRead(LOADER_CONSOLE_UART, &dst[count], size - count, &lineStatus);
+        }
 
-        if(per < inc )
+        if(deadline_expired(&progress))
         {
-            inc = 0;
-            (void)putc('=');
+            uint32_t done = count / per;
+            for(; marks < done && marks < LOADER_PROGRESS_MARKS; marks++)
+            {
+                (void)putc('=');
+            }
+            deadline_set_ms(&progress, LOADER_PROGRESS_MS);
         }
     }
-    (void)putc('=');
+    for(; marks < LOADER_PROGRESS_MARKS; marks++)
+    {
+        (void)putc('=');
+    }
     (void)putc('\r');
     (void)putc('\n');
 
+    bootstage_mark("serial load done");
+
+    LoaderRestoreBaudrate(restore);
+
+    if(compressed)
+    {
+        uint32_t outSize;
+        lz4Ret = LoaderLz4Finish(&lz4, lz4Ret, &outSize);
+    }
+
+    if(lineStatus != 0)
+    {
+        puts("Receive errors:");
+        if(lineStatus & (UART_LSR_OE | UART_LSR_FIFOERR))
+        {
+            puts(" overrun");
+        }
+        if(lineStatus & UART_LSR_FE)
+        {
+            puts(" framing");
+        }
+        if(lineStatus & UART_LSR_PE)
+        {
+            puts(" parity");
+        }
+        if(lineStatus & UART_LSR_BI)
+        {
+            puts(" break");
+        }
+        puts("\n");
+        return E_ERROR;
+    }
+
+    return lz4Ret;
+}
+
+int32_t LoaderFrameLoad(ptr_t addr, uint32_t baudrate, bool_t delta)
+{
+    xfer_stats_t stats;
+    uint32_t restore;
+    uint32_t size = LoaderRoom(addr);
+
+    if(LoaderCheckRange(addr, 1) != E_OK)
+    {
+        return E_INVAL;
+    }
+
+    int32_t ret = LoaderSwitchBaudrate(baudrate, &restore);
+    if(ret != E_OK)
+    {
+        return ret;
+    }
+
+    puts(((delta) ? ("Waiting for delta transfer\n") : ("Waiting for framed transfer\n")));
+    bootstage_mark("frame load start");
+
+    ret = XferReceive(addr, &size, delta, &stats);
+
+    bootstage_mark("frame load done");
+    LoaderRestoreBaudrate(restore);
+
+    switch(ret)
+    {
+    case E_OK:
+        LoaderPutStat("Received ", size);
+        puts(" bytes\n");
+        break;
+    case E_ERROR:
+        puts("Image checksum mismatch\n");
+        break;
+    case E_AGAIN:
+        puts("Transfer timed out\n");
+        break;
+    case E_NO_MEMORY:
+        puts("Image overlaps the bootloader reserved memory\n");
+        break;
+    default:
+        puts("Transfer rejected\n");
+        break;
+    }
+
+    LoaderPutStat("packets ", stats.packets);
+    LoaderPutStat(" duplicates ", stats.duplicates);
+    LoaderPutStat(" crc errors ", stats.crcErrors);
+    LoaderPutStat(" naks ", stats.naks);
+    if(delta)
+    {
+        LoaderPutStat(" unchanged ", stats.skipped);
+    }
+    puts("\n");
+
+    return ret;
+}
+
+int32_t LoaderYmodemLoad(ptr_t addr, char* path)
+{
+    ymodem_file_t file;
+
+    if(LoaderCheckRange(addr, 1) != E_OK)
+    {
+        return E_INVAL;
+    }
+
+    puts("Start the YMODEM/XMODEM-1K send\n");
+    bootstage_mark("ymodem load start");
+
+    int32_t ret = YmodemReceive(addr, LoaderRoom(addr), &file);
+
+    bootstage_mark("ymodem load done");
+
+    if(ret != E_OK)
+    {
+        if(ret == E_NO_MEMORY)
+        {
+            puts("\nFile overlaps the bootloader reserved memory\n");
+        }
+        else
+        {
+            puts(((ret == E_AGAIN) ? ("\nTransfer timed out\n") : ("\nTransfer cancelled\n")));
+        }
+        return ret;
+    }
+
+    puts("\nReceived ");
+    puts(file.name);
+    LoaderPutStat(" size ", file.size);
+    LoaderPutStat(" blocks ", file.blocks);
+    LoaderPutStat(" errors ", file.errors);
+    puts("\n");
+
+    if(path == NULL)
+    {
+        return E_OK;
+    }
+
+    /* A directory path keeps the name sent by the host */
+    char save[LOADER_PATH_MAX];
+    uint32_t len = strlen(path);
+    if(len > 0 && path[len - 1] == '/')
+    {
+        if(file.name[0] == '\0' || (len + strlen(file.name)) >= LOADER_PATH_MAX)
+        {
+            puts("No file name to save\n");
+            return E_INVAL;
+        }
+        strcpy(save, path);
+        strcpy(&save[len], file.name);
+    }
+    else
+    {
+        if(len >= LOADER_PATH_MAX)
+        {
+            return E_INVAL;
+        }
+        strcpy(save, path);
+    }
+
+    /* Files are never overwritten */
+    struct stat st;
+    if(Fat32Stat(save, &st) == E_OK)
+    {
+        puts("File exists: ");
+        puts(save);
+        puts("\n");
+        return E_INVAL;
+    }
+
+    if(Fat32MkFile(save, file.size, (const uint8_t*)addr) != E_OK)
+    {
+        puts("Failed to write file: ");
+        puts(save);
+        puts("\n");
+        return E_ERROR;
+    }
+
+    puts("Saved to ");
+    puts(save);
+    puts("\n");
+
     return E_OK;
 }
 
 int32_t LoaderSdLoad(ptr_t addr, char* file)
 {
-    uint32_t size = Fat32ReadFile(file, addr, 0, (uint32_t)-1);
-    if(size == 0)
+    fat32_file_t handle;
+    uint32_t head = 0;
+    int32_t size = 0;
+    int32_t ret = E_OK;
+
+    bootstage_mark("sd load start");
+
+    if(Fat32Open(&handle, file) == E_OK)
+    {
+        if(Fat32Read(&handle, (uint8_t*)&head, 4) == 4 && lz4_is_frame(&head))
+        {
+            /* Decompress while the file is read, one staging buffer at a time */
+            uint8_t *stage = (uint8_t *)LOADER_STAGE_ADDR;
+            lz4_stream_t lz4;
+            uint32_t outSize = 0;
+            int32_t n;
+
+            lz4_stream_init(&lz4, addr, LoaderRoom(addr));
+            ret = lz4_stream_write(&lz4, &head, 4);
+            while(ret == E_OK && (n = Fat32Read(&handle, stage, LOADER_STAGE_SIZE)) > 0)
+            {
+                ret = lz4_stream_write(&lz4, stage, (uint32_t)n);
+            }
+            ret = LoaderLz4Finish(&lz4, ret, &outSize);
+            size = (int32_t)outSize;
+        }
+        else if(LoaderCheckRange(addr, handle.size) != E_OK)
+        {
+            ret = E_INVAL;
+        }
+        else if(Fat32Seek(&handle, 0) == E_OK)
+        {
+            size = Fat32Read(&handle, addr, handle.size);
+        }
+        (void)Fat32Close(&handle);
+    }
+
+    bootstage_mark("sd load done");
+    if(size == 0 || ret != E_OK)
     {
         puts("Failed to read file: ");
         puts(file);
@@ -184,4 +635,91 @@ int32_t LoaderSdLoad(ptr_t addr, char* file)
         puts("\n");
         return E_OK;
     }
-}
\ No newline at end of file
+}
+
+int32_t LoaderBootstage(void)
+{
+    bootstage_report();
+
+    return E_OK;
+}
+
+int32_t LoaderCacheStats(void)
+{
+    bcache_stats_t bcache;
+    fat32_cache_stats_t fat;
+
+    BcacheGetStats(&bcache);
+    Fat32GetCacheStats(&fat);
+
+    LoaderPutStat("Block cache: hits ", bcache.hits);
+    LoaderPutStat(" misses ", bcache.misses);
+    LoaderPutStat(" writebacks ", bcache.writebacks);
+    LoaderPutStat(" bypassed ", bcache.bypassed);
+    puts("\n");
+
+    LoaderPutStat("Read ahead: blocks ", bcache.readaheads);
+    LoaderPutStat(" used ", bcache.raHits);
+    LoaderPutStat(" wasted ", bcache.raWasted);
+    LoaderPutStat(" cancelled ", bcache.raCancelled);
+    puts("\n");
+
+    LoaderPutStat("FAT windows: hits ", fat.hits);
+    LoaderPutStat(" misses ", fat.misses);
+    LoaderPutStat(" readaheads ", fat.readaheads);
+    LoaderPutStat(" writebacks ", fat.writebacks);
+    puts("\n");
+
+    return E_OK;
+}
+
+int32_t LoaderWipe(uint32_t partition)
+{
+    uint8_t* mbr = (uint8_t*)LOADER_STAGE_ADDR;
+    uint32_t start, count;
+    ulong_t volStart, volCount;
+
+    if(partition == 0 || partition > LOADER_PART_COUNT)
+    {
+        puts("Partitions are 1 to 4\n");
+        return E_INVAL;
+    }
+
+    if(mmc_bread(LOADER_SD, 0, 1, mbr) != 1)
+    {
+        puts("Failed to read the partition table\n");
+        return E_ERROR;
+    }
+
+    // Entries are not word aligned
+    memcpy(&start, &mbr[LOADER_PART_TABLE + ((partition - 1) * 16) + 8], sizeof(start));
+    memcpy(&count, &mbr[LOADER_PART_TABLE + ((partition - 1) * 16) + 12], sizeof(count));
+    if(count == 0)
+    {
+        puts("Partition is empty\n");
+        return E_INVAL;
+    }
+
+    // The block cache and FAT32 state would go stale under the mounted volume
+    Fat32GetVolume(&volStart, &volCount);
+    if(start < (volStart + volCount) && volStart < (start + count))
+    {
+        puts("Partition holds the mounted FAT32 volume\n");
+        return E_BUSY;
+    }
+
+    bootstage_mark("wipe start");
+    int32_t wiped = mmc_berase(LOADER_SD, start, count);
+    bootstage_mark("wipe done");
+
+    if((uint32_t)wiped != count)
+    {
+        puts("Failed to wipe the partition\n");
+        return E_ERROR;
+    }
+
+    LoaderPutStat("Wiped blocks ", count);
+    puts("\n");
+
+    return E_OK;
+}
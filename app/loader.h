@@ -23,6 +23,24 @@
 
 /* Exported constants ------------------------------------- */
 
+/* DRAM kept by the bootloader, every load has to stay out of
+ * [LOADER_RESERVED_START, LOADER_RESERVED_END) */
+#define LOADER_STAGE_ADDR       (0x4FD00000)    /* Compressed input staging */
+#define LOADER_STAGE_SIZE       (0x00100000)
+#define LOADER_RX_RING_ADDR     (0x4FE00000)    /* Serial RX ring filled by the uart interrupt */
+#define LOADER_RX_RING_SIZE     (0x00100000)
+#define LOADER_DRAM_IMAGE_ADDR  (0x4FF00000)    /* Bootloader part run from DRAM, see lscript.lds */
+#define LOADER_DRAM_IMAGE_SIZE  (0x000F0000)
+#define LOADER_BOOTSTAGE_ADDR   (0x4FFF0000)    /* Bootstage table, see BOOTSTAGE_DRAM_ADDR */
+#define LOADER_BOOTSTAGE_SIZE   (0x00010000)
+#define LOADER_FS_BUFFER_ADDR   (0x50000000)    /* Block cache and FAT32 buffers */
+#define LOADER_FS_BUFFER_SIZE   (0x01000000)
+#define LOADER_MMC_TUNE_ADDR    (0x51000000)    /* SD bus tuning scratch */
+#define LOADER_MMC_TUNE_SIZE    (0x00001000)
+
+#define LOADER_RESERVED_START   (LOADER_STAGE_ADDR)
+#define LOADER_RESERVED_END     (LOADER_MMC_TUNE_ADDR + LOADER_MMC_TUNE_SIZE)
+
 
 /* Exported macros ---------------------------------------- */
 
@@ -30,16 +48,28 @@
 /* Exported functions ------------------------------------- */
 
 
+void LoaderInit(ulong_t dramEnd);
+
 void LoaderGo(ptr_t addr, uint32_t core, uint32_t arg0, uint32_t arg1);
 
 int32_t LoaderWrite(ptr_t addr, uint32_t data);
 
 int32_t LoaderRead(ptr_t addr, uint32_t *data);
 
-int32_t LoaderSerialLoad(ptr_t addr, uint32_t size);
+int32_t LoaderSerialLoad(ptr_t addr, uint32_t size, uint32_t baudrate);
+
+int32_t LoaderFrameLoad(ptr_t addr, uint32_t baudrate, bool_t delta);
+
+int32_t LoaderYmodemLoad(ptr_t addr, char* path);
 
 int32_t LoaderSdLoad(ptr_t addr, char* file);
 
+int32_t LoaderBootstage(void);
+
+int32_t LoaderCacheStats(void);
+
+int32_t LoaderWipe(uint32_t partition);
+
 #ifdef __cplusplus
     }
 #endif
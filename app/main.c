@@ -5,17 +5,24 @@
 #include <dram.h>
 #include <ccu.h>
 #include <pmu.h>
+#include <gic.h>
+#include <delay.h>
+#include <bootstage.h>
+#include <mmu.h>
 #include <mmc_bsp.h>
 #include <mmc.h>
 #include <fat32.h>
 
 // bootLoader processes
 #include <cmd.h>
+#include <loader.h>
 
 #include <serial.h>
 #include <misc.h>
 #include <string.h>
 #include <debug.h>
+#include <helper.h>
+#include <crc32.h>
 
 typedef struct
 {
@@ -40,18 +47,122 @@ typedef struct
 #define SD                      (0)
 #define PARTITION_TABLE_OFFSET  (0x01BE)
 
-int32_t FileSystemInit(void)
+/* The DRAM part is written 32KB after the SRAM part (sector 16), see Makefile */
+#define DRAM_IMAGE_SECTOR       (80)
+#define DRAM_IMAGE_MAGIC        (0x4D415244)
+
+/* DRAM part bounds from the linker script */
+extern uint32_t _dram_image_start[];
+extern uint32_t _dram_image_end[];
+extern uint32_t _dram_bss_start[];
+extern uint32_t _dram_bss_end[];
+
+static ulong_t dramSize = 0;
+
+#if (SUNXI_MMC_TUNE_BUFFER_SIZE > LOADER_MMC_TUNE_SIZE)
+#error "SD bus tuning scratch does not fit in LOADER_MMC_TUNE_SIZE"
+#endif
+
+/* Load the part of the bootloader that runs from DRAM */
+static int32_t DramImageLoad(void)
 {
-    // For now!!!
-    uint8_t* buffer = (uint8_t*)0x50000000;
+    uint32_t size = (uint32_t)_dram_image_end - (uint32_t)_dram_image_start;
+    uint32_t blocks = (size + 511) / 512;
 
     puts("Initialize SD Card...\n");
-    if(sunxi_mmc_init(SD) < 0 || mmc_bread(SD, 0, 1, buffer) == 0)
+    if(sunxi_mmc_init(SD) < 0 || mmc_bread(SD, DRAM_IMAGE_SECTOR, blocks, _dram_image_start) != blocks)
     {
-        puts("ERROR: Failed to init SD Card!");
+        puts("ERROR: Failed to init SD Card!\n");
         return E_ERROR;
     }
-    
+    bootstage_mark("mmc init");
+
+    // A card written with another build has a different size
+    if(_dram_image_start[0] != DRAM_IMAGE_MAGIC || _dram_image_start[1] != size)
+    {
+        puts("ERROR: No matching DRAM part on the SD Card!\n");
+        return E_ERROR;
+    }
+
+    memset(_dram_bss_start, 0x0, (uint32_t)_dram_bss_end - (uint32_t)_dram_bss_start);
+
+    // The code was written as data
+    dcache_clean_range((uint32_t)_dram_image_start, size);
+    icache_invalidate_all();
+    bootstage_mark("dram part");
+
+    return E_OK;
+}
+
+/* Tune the SD bus, reusing the result saved for this card on a previous boot */
+static void SdTune(void)
+{
+    struct mmc* mmc = find_mmc_device(SD);
+    struct sunxi_mmc_tuning tuning, saved;
+    char path[20] = "/mmc-";
+    char str[12];
+
+    // One file per card, named after its CID
+    itoa((int32_t)crc32(0, mmc->cid, sizeof(mmc->cid)), &path[5], 16);
+    strcpy(&path[strlen(path)], ".tun");
+
+    memset(&saved, 0x0, sizeof(saved));
+    struct stat st;
+    bool_t found = (Fat32Stat(path, &st) == E_OK);
+    if(found)
+    {
+        (void)Fat32ReadFile(path, (uint8_t*)&saved, 0, sizeof(saved));
+    }
+    memcpy(&tuning, &saved, sizeof(tuning));
+
+    if(sunxi_mmc_tune(SD, &tuning, (uint8_t*)LOADER_MMC_TUNE_ADDR) != E_OK)
+    {
+        puts("WARNING: SD bus tuning failed, staying at the default clock\n");
+        return;
+    }
+
+    puts("SD bus at ");
+    puts(itoa((int32_t)(tuning.clock / 1000), str, 10));
+    puts(" kHz, sample delay ");
+    puts(itoa(tuning.sclk_dly, str, 10));
+    puts(", drive ");
+    puts(itoa(tuning.drv, str, 10));
+    puts("\n");
+
+    if(found)
+    {
+        // Files are never overwritten, a stale result stays until it is deleted
+        if(memcmp(&tuning, &saved, sizeof(tuning)))
+        {
+            puts("Saved SD bus tuning is stale, delete ");
+            puts(path);
+            puts(" to keep the new one\n");
+        }
+        return;
+    }
+
+#ifdef CONFIG_MMC_TUNE_SAVE
+    // Files are written in whole sectors, the tuning scratch is free again
+    uint8_t* sector = (uint8_t*)LOADER_MMC_TUNE_ADDR;
+    memset(sector, 0x0, 512);
+    memcpy(sector, &tuning, sizeof(tuning));
+    if(Fat32MkFile(path, sizeof(tuning), sector) != E_OK)
+    {
+        puts("WARNING: Failed to save SD bus tuning\n");
+    }
+#endif
+}
+
+int32_t FileSystemInit(void)
+{
+    uint8_t* buffer = (uint8_t*)LOADER_FS_BUFFER_ADDR;
+
+    if(mmc_bread(SD, 0, 1, buffer) == 0)
+    {
+        puts("ERROR: Failed to read the partition table!");
+        return E_ERROR;
+    }
+
 //    part_table_t* part_table = (part_table_t*)(&buffer[PARTITION_TABLE_OFFSET]);
 
     part_table_t part_table;
@@ -62,13 +173,17 @@ int32_t FileSystemInit(void)
     DEBUG_DUMP_STR("\n");
 
     puts("Mount FAT32 filesystem...\n");
-    if(Fat32Init(SD, part_table.sectors_before, buffer) != E_OK)
+    if(Fat32Init(SD, part_table.sectors_before, buffer, LOADER_FS_BUFFER_SIZE) != E_OK)
     {
         puts("ERROR: Failed to initialize Fat32 file system!");
         return E_ERROR;
     }
 
     puts("FAT32 filesystem mounted\n");
+    bootstage_mark("fat32 mount");
+
+    SdTune();
+    bootstage_mark("mmc tune");
 
     return E_OK;
 }
@@ -76,20 +191,30 @@ int32_t FileSystemInit(void)
 // This will be moved to another place since is board dependent
 int32_t BoardInit(void)
 {
+    /* Initialize the time base (generic timer) */
+    delay_init();
+    bootstage_mark("start");
+
     /* Initialize PMU */
     pmu_ini();
+    bootstage_mark("pmu");
 
     /* Initialize GPIO */
     GpioInit();
+    bootstage_mark("gpio");
     
     /* Set CPU clock speed */
     clock_set_pll1(1000000000);
+    bootstage_mark("pll1");
 
     writel(PLL6_CFG_DEFAULT, PLL_PERIPH0_CTRL_REG);
     while (!(readl(PLL_PERIPH0_CTRL_REG) & CCM_PLL6_CTRL_LOCK))
         ;
+    bootstage_mark("pll6");
 
     writel(AHB1_ABP1_DIV_DEFAULT, (AHB1_APB1_CFG_REG));
+    /* UART clock from PLL6 so the high baudrates divide evenly */
+    clock_set_apb2(APB2_DIV_DEFAULT);
 
     // Configure pin GPA_15 as output
     GpioSetCfgpin(GPA(15) , GPIO_OUTPUT);
@@ -103,8 +228,18 @@ int32_t BoardInit(void)
 
     /* Initialize Uart 0*/
     UartInit(UART0, BAUD_115200, LC_8_N_1);
+    bootstage_mark("uart");
     /* Initialize Dram*/
-    DramInit();
+    dramSize = DramInit();
+    if(dramSize == 0)
+    {
+        puts("ERROR: DRAM controller did not come up!\n");
+        return E_ERROR;
+    }
+    /* DRAM can now be mapped as cacheable memory */
+    mmu_set_region(DRAM_BASE, dramSize, MMU_SECTION_NORMAL);
+    bootstage_relocate();
+    bootstage_mark("dram");
 
     return E_OK;
 }
@@ -112,10 +247,33 @@ int32_t BoardInit(void)
 int32_t main(void)
 {
     /* Initialize the Board Processor and Peripherals*/
-    BoardInit();
+    if(BoardInit() != E_OK)
+    {
+        while(1);
+    }
 
     puts("\nBootLoader 1.0\n");
 
+    /* Everything from here on runs from DRAM */
+    if(DramImageLoad() != E_OK)
+    {
+        while(1);
+    }
+
+    LoaderInit(DRAM_BASE + dramSize);
+
+    /* Serial reception keeps going while the CPU is busy */
+    GicInit();
+    if(UartEnableRxInterrupt(UART0, (uint8_t*)LOADER_RX_RING_ADDR, LOADER_RX_RING_SIZE) == E_OK)
+    {
+        irq_enable();
+    }
+    bootstage_mark("irq");
+
+#ifdef CONFIG_STRING_BENCH
+    StringBench();
+#endif
+
     /* Initialize FileSystem */
     if(FileSystemInit() != E_OK)
     {
@@ -18,7 +18,8 @@
 /* Private constants -------------------------------------- */
 
 #define MAXCOMMANDS     cmdInvalid
-#define MAXLOADTYPES    2
+#define MAXLOADTYPES    5
+#define MAXCMDSTRING    16
 
 /* Private macros ----------------------------------------- */
 
@@ -37,21 +38,23 @@
 
 static struct
 {
-    char    str[8];
+    char    str[MAXCMDSTRING];
     cmd_t   cmd;
 }commandEntries[MAXCOMMANDS] =
 {
     {"help",cmdHelp}, {"load",cmdLoad}, {"go",cmdGo},
-    {"read",cmdRead}, {"write",cmdWrite}
+    {"read",cmdRead}, {"write",cmdWrite}, {"bootstage",cmdBootstage},
+    {"cache",cmdCache}, {"wipe",cmdWipe}
 };
 
 static struct
 {
-    char            str[8];
+    char            str[MAXCMDSTRING];
     cmdLoadType_t   cmd;
 }loadTypesEntries[MAXLOADTYPES] =
 {
-    {"serial",cmdSerial}, {"sd",cmdSd}
+    {"serial",cmdSerial}, {"sd",cmdSd}, {"frame",cmdFrame},
+    {"ymodem",cmdYmodem}, {"serial-delta",cmdSerialDelta}
 };
 
 
@@ -102,7 +105,7 @@ cmd_t CmdParserGetAction(char **str, int32_t *state)
 
     uint32_t index = 0;
     cmd_t cmd;
-    char cmdStr[8];
+    char cmdStr[MAXCMDSTRING];
 
     GETCMDSTRING(index, str, cmdStr);
 
@@ -183,7 +186,7 @@ cmdLoadType_t CmdParserGetLoadType(char **str, int32_t *state)
 {
     uint32_t index = 0;
     cmdLoadType_t loadType;
-    char cmdStr[8];
+    char cmdStr[MAXCMDSTRING];
 
     GETCMDSTRING(index, str, cmdStr);
 
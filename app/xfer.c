@@ -0,0 +1,377 @@
+/**
+ * @file        xfer.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Framed serial transfer protocol: fixed size packets with
+ *              crc32, a sliding window and selective retransmission
+*/
+
+/* Includes ----------------------------------------------- */
+#include <xfer.h>
+#include <uart.h>
+#include <crc32.h>
+#include <delay.h>
+#include <string.h>
+#include <misc.h>
+
+
+/* Private types ------------------------------------------ */
+
+typedef struct
+{
+    uint8_t  sync;
+    uint8_t  type;
+    uint16_t len;
+    uint32_t seq;
+    uint8_t  payload[XFER_PAYLOAD_SIZE];
+    uint32_t crc;
+}xfer_packet_t;
+
+typedef struct
+{
+    uint8_t  sync;
+    uint8_t  type;
+    uint16_t count;
+    uint32_t value;
+    uint32_t crc;
+}xfer_reply_t;
+
+
+/* Private constants -------------------------------------- */
+
+#define XFER_UART           UART0
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+static union
+{
+    xfer_packet_t packet;
+    uint8_t bytes[XFER_PACKET_SIZE];
+}XferFrame;
+
+static uint32_t XferFill;
+
+/* Delta mode: bit n set when block n has to be received */
+static uint8_t XferMap[XFER_DELTA_BLOCKS / 8];
+static bool_t XferDelta;
+static uint32_t XferBlockShift;     /* log2 of the packets per block */
+
+
+/* Private function prototypes ---------------------------- */
+
+static void XferPutBytes(const void* buf, uint32_t len)
+{
+    const char *p = (const char *)buf;
+
+    while(len--)
+    {
+        UartPutc(XFER_UART, *p++);
+    }
+}
+
+static void XferReplyCount(uint8_t type, uint16_t count, uint32_t value)
+{
+    xfer_reply_t reply;
+
+    reply.sync = XFER_SYNC_TARGET;
+    reply.type = type;
+    reply.count = count;
+    reply.value = value;
+    reply.crc = crc32(0, &reply, sizeof(reply) - sizeof(reply.crc));
+
+    XferPutBytes(&reply, sizeof(reply));
+}
+
+static void XferReply(uint8_t type, uint32_t value)
+{
+    XferReplyCount(type, 0, value);
+}
+
+/* Delta mode: report the crc32 of every block in memory */
+static void XferSendHashes(const uint8_t* dst, uint32_t size)
+{
+    uint32_t blockSize = (XFER_PAYLOAD_SIZE << XferBlockShift);
+    uint32_t blocks = (size + blockSize - 1) / blockSize;
+    uint32_t listCrc = 0;
+    uint32_t i;
+
+    XferReplyCount(XFER_HASHES, (uint16_t)blocks, blockSize);
+
+    for(i = 0; i < blocks; i++)
+    {
+        uint32_t offset = i * blockSize;
+        uint32_t hash = crc32(0, &dst[offset], min(blockSize, size - offset));
+
+        listCrc = crc32(listCrc, &hash, 4);
+        XferPutBytes(&hash, 4);
+    }
+    XferPutBytes(&listCrc, 4);
+}
+
+static inline bool_t XferNeeded(uint32_t seq)
+{
+    uint32_t block = seq >> XferBlockShift;
+
+    return (!XferDelta || (XferMap[block >> 3] & (1 << (block & 7))));
+}
+
+/* Drop the first byte and everything up to the next sync byte */
+static void XferResync(void)
+{
+    uint32_t i = 1;
+    uint32_t j = 0;
+
+    while(i < XferFill && XferFrame.bytes[i] != XFER_SYNC_HOST)
+    {
+        i++;
+    }
+    for(; i < XferFill; i++, j++)
+    {
+        XferFrame.bytes[j] = XferFrame.bytes[i];
+    }
+    XferFill = j;
+}
+
+/* Assemble a packet from the received data, TRUE once a valid one is ready */
+static bool_t XferGetPacket(xfer_stats_t* stats)
+{
+    while(TRUE)
+    {
+        if(XferFill > 0 && XferFrame.bytes[0] != XFER_SYNC_HOST)
+        {
+            XferResync();
+            continue;
+        }
+
+        if(XferFill < XFER_PACKET_SIZE)
+        {
+            uint32_t n = UartRead(XFER_UART, &XferFrame.bytes[XferFill], XFER_PACKET_SIZE - XferFill, &stats->lineErrors);
+            if(n == 0)
+            {
+                return FALSE;
+            }
+            XferFill += n;
+            continue;
+        }
+
+        if(crc32(0, XferFrame.bytes, XFER_PACKET_SIZE - 4) != XferFrame.packet.crc)
+        {
+            stats->crcErrors++;
+            XferResync();
+            continue;
+        }
+
+        XferFill = 0;
+        return TRUE;
+    }
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * XferReceive Implementation (See header file for description)
+*/
+int32_t XferReceive(ptr_t addr, uint32_t* size, bool_t delta, xfer_stats_t* stats)
+{
+    xfer_packet_t *packet = &XferFrame.packet;
+    uint8_t *dst = (uint8_t *)addr;
+    const uint32_t room = *size;
+    uint32_t imageSize = 0;
+    uint32_t imageCrc = 0;
+    uint32_t total = 0;
+    bool_t started = FALSE;
+    bool_t mapped = !delta;     /* Delta mode: MAP received */
+    uint32_t base = 0;          /* First packet not received yet */
+    uint32_t received = 0;      /* Bit n: packet base + n received */
+    uint32_t nakked = 0;        /* Bit n: packet base + n already NAKed */
+    uint32_t retries = 0;
+    deadline_t timeout;
+
+    memset(stats, 0, sizeof(xfer_stats_t));
+    XferFill = 0;
+    XferDelta = delta;
+    XferBlockShift = 0;
+    deadline_set_ms(&timeout, XFER_TIMEOUT_MS);
+
+    while(TRUE)
+    {
+        if(!XferGetPacket(stats))
+        {
+            if(!deadline_expired(&timeout))
+            {
+                continue;
+            }
+            if(++retries > XFER_RETRIES)
+            {
+                return E_AGAIN;
+            }
+            if(started && mapped)
+            {
+                /* Lost packets or replies, ask again for the oldest one */
+                XferReply(XFER_NAK, base);
+                stats->naks++;
+                nakked = 0;
+            }
+            deadline_set_ms(&timeout, XFER_TIMEOUT_MS);
+            continue;
+        }
+
+        retries = 0;
+        deadline_set_ms(&timeout, XFER_TIMEOUT_MS);
+
+        switch(packet->type)
+        {
+        case XFER_START:
+        {
+            if(!started)
+            {
+                memcpy(&imageSize, &packet->payload[0], 4);
+                memcpy(&imageCrc, &packet->payload[4], 4);
+                if(imageSize == 0 || imageSize > room)
+                {
+                    XferReply(XFER_FAIL, 0);
+                    return ((imageSize == 0) ? (E_INVAL) : (E_NO_MEMORY));
+                }
+                total = (imageSize + XFER_PAYLOAD_SIZE - 1) / XFER_PAYLOAD_SIZE;
+                started = TRUE;
+
+                /* Blocks grow until the bitmap fits in one packet */
+                while((total >> XferBlockShift) >= XFER_DELTA_BLOCKS || (XFER_PAYLOAD_SIZE << XferBlockShift) < XFER_DELTA_BLOCK)
+                {
+                    XferBlockShift++;
+                }
+            }
+
+            if(!mapped)
+            {
+                /* Sent again when the host missed them */
+                XferSendHashes(dst, imageSize);
+            }
+            else
+            {
+                XferReply(XFER_ACK, base);
+            }
+            break;
+        }
+        case XFER_MAP:
+        {
+            if(!started || !delta)
+            {
+                break;
+            }
+
+            if(!mapped)
+            {
+                memcpy(XferMap, packet->payload, sizeof(XferMap));
+                mapped = TRUE;
+
+                /* Skip what is already in memory */
+                while(base < total && !XferNeeded(base))
+                {
+                    base++;
+                    stats->skipped++;
+                }
+            }
+            XferReply(XFER_ACK, base);
+            break;
+        }
+        case XFER_DATA:
+        {
+            uint32_t seq = packet->seq;
+
+            if(!started || !mapped)
+            {
+                break;
+            }
+
+            if(seq >= base && seq < (base + XFER_WINDOW) && seq < total && XferNeeded(seq))
+            {
+                uint32_t bit = seq - base;
+                uint32_t offset = seq * XFER_PAYLOAD_SIZE;
+                uint32_t len = min((uint32_t)XFER_PAYLOAD_SIZE, imageSize - offset);
+                uint32_t i;
+
+                if(packet->len != len)
+                {
+                    break;
+                }
+
+                if(received & (1u << bit))
+                {
+                    stats->duplicates++;
+                }
+                else
+                {
+                    memcpy(&dst[offset], packet->payload, len);
+                    received |= (1u << bit);
+                    stats->packets++;
+                }
+
+                /* Ask once for every hole in front of this packet */
+                for(i = 0; i < bit; i++)
+                {
+                    if(!((received | nakked) & (1u << i)) && XferNeeded(base + i))
+                    {
+                        XferReply(XFER_NAK, base + i);
+                        nakked |= (1u << i);
+                        stats->naks++;
+                    }
+                }
+
+                /* Slide the window, over the unchanged blocks too */
+                while(base < total && ((received & 1) || !XferNeeded(base)))
+                {
+                    if(!(received & 1))
+                    {
+                        stats->skipped++;
+                    }
+                    received >>= 1;
+                    nakked >>= 1;
+                    base++;
+                }
+            }
+            else if(seq < base)
+            {
+                stats->duplicates++;
+            }
+
+            XferReply(XFER_ACK, base);
+            break;
+        }
+        case XFER_END:
+        {
+            if(!started || !mapped)
+            {
+                break;
+            }
+
+            if(base < total)
+            {
+                XferReply(XFER_NAK, base);
+                stats->naks++;
+                break;
+            }
+
+            uint32_t crc = crc32(0, dst, imageSize);
+            if(crc != imageCrc)
+            {
+                XferReply(XFER_FAIL, crc);
+                return E_ERROR;
+            }
+
+            XferReply(XFER_DONE, crc);
+            *size = imageSize;
+            return E_OK;
+        }
+        default:
+            break;
+        }
+    }
+}
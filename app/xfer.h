@@ -0,0 +1,100 @@
+/**
+ * @file        xfer.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Framed serial transfer protocol Header File
+*/
+
+#ifndef XFER_H
+#define XFER_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported constants ------------------------------------- */
+
+/*
+ * Host -> target packet, little endian, always XFER_PACKET_SIZE bytes:
+ *   sync (0xA5) | type | len (16) | seq (32) | payload[XFER_PAYLOAD_SIZE] | crc32
+ * The crc32 covers everything before it. START carries the image size and
+ * crc32 in its payload, DATA packet seq holds bytes [seq * XFER_PAYLOAD_SIZE,
+ * +len) and END asks for the whole image check.
+ *
+ * Target -> host reply, 12 bytes:
+ *   sync (0x5A) | type | count (16) | value (32) | crc32
+ * ACK value is the next packet expected (all before it were received), NAK
+ * value is a missing packet to resend, DONE/FAIL value is the image crc32.
+ *
+ * The target accepts packets in [ACK, ACK + XFER_WINDOW) in any order.
+ *
+ * Delta mode: START is answered with HASHES (value is the block size, count
+ * the number of blocks) followed by the crc32 of every block currently in
+ * memory and a crc32 of that list. The host answers with a MAP packet, a
+ * bitmap of the blocks that differ, and then only sends the DATA packets of
+ * those blocks. ACK/NAK/END work as in a full transfer.
+ */
+#define XFER_SYNC_HOST      (0xA5)
+#define XFER_SYNC_TARGET    (0x5A)
+
+#define XFER_START          (0x01)
+#define XFER_DATA           (0x02)
+#define XFER_END            (0x03)
+#define XFER_MAP            (0x04)
+
+#define XFER_ACK            (0x10)
+#define XFER_NAK            (0x11)
+#define XFER_DONE           (0x12)
+#define XFER_FAIL           (0x13)
+#define XFER_HASHES         (0x14)
+
+#define XFER_PAYLOAD_SIZE   (1024)
+#define XFER_HEADER_SIZE    (8)
+#define XFER_PACKET_SIZE    (XFER_HEADER_SIZE + XFER_PAYLOAD_SIZE + 4)
+#define XFER_WINDOW         (16)            /* Packets, at most 32 */
+
+#define XFER_DELTA_BLOCK    (4096)          /* Smallest delta block, grows to fit the map */
+#define XFER_DELTA_BLOCKS   (XFER_PAYLOAD_SIZE * 8)
+
+#define XFER_TIMEOUT_MS     (500)           /* Silence before the target NAKs */
+#define XFER_RETRIES        (20)            /* Timeouts in a row before giving up */
+
+
+/* Exported types ----------------------------------------- */
+
+typedef struct
+{
+    uint32_t packets;       /* Data packets stored */
+    uint32_t duplicates;    /* Data packets received more than once */
+    uint32_t crcErrors;     /* Packets discarded by the crc check */
+    uint32_t naks;          /* Retransmissions requested */
+    uint32_t lineErrors;    /* UART_LSR_* seen while receiving */
+    uint32_t skipped;       /* Delta mode: packets already in memory */
+}xfer_stats_t;
+
+
+/* Exported functions ------------------------------------- */
+
+/**
+ * @brief	Receive an image with the framed protocol
+ * @param	addr - destination
+ * 			size - room at addr, receives the image size
+ * 			delta - only receive the blocks that differ from memory at addr
+ * 			stats - transfer statistics
+ * @retval	E_OK, E_ERROR on image crc mismatch, E_AGAIN if the host went
+ * 			silent, E_INVAL for an empty image or E_NO_MEMORY if it does
+ * 			not fit
+ */
+int32_t XferReceive(ptr_t addr, uint32_t* size, bool_t delta, xfer_stats_t* stats);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif // XFER_H
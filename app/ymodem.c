@@ -0,0 +1,359 @@
+/**
+ * @file        ymodem.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       XMODEM-1K/YMODEM receiver, works with stock terminal programs
+ *              (sz/sb, minicom, picocom, Tera Term)
+*/
+
+/* Includes ----------------------------------------------- */
+#include <ymodem.h>
+#include <uart.h>
+#include <crc16.h>
+#include <delay.h>
+#include <helper.h>
+#include <string.h>
+#include <misc.h>
+
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+#define YMODEM_UART         UART0
+
+#define YMODEM_SOH          (0x01)      /* 128 byte block */
+#define YMODEM_STX          (0x02)      /* 1024 byte block */
+#define YMODEM_EOT          (0x04)
+#define YMODEM_ACK          (0x06)
+#define YMODEM_NAK          (0x15)
+#define YMODEM_CAN          (0x18)
+#define YMODEM_CRC          ('C')       /* Request CRC16 mode */
+
+#define YMODEM_BLOCK_SIZE   (1024)
+#define YMODEM_PURGE_MS     (200)       /* Line idle time that ends a purge */
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+/* Block number, its complement, data and CRC16 */
+static uint8_t YmodemBlock[2 + YMODEM_BLOCK_SIZE + 2];
+
+
+/* Private function prototypes ---------------------------- */
+
+static void YmodemPutc(uint8_t c)
+{
+    UartPutc(YMODEM_UART, (char)c);
+}
+
+/* Receive len bytes, FALSE if the line went silent */
+static bool_t YmodemGetBytes(uint8_t* buf, uint32_t len, uint32_t timeoutMs)
+{
+    uint32_t lineStatus = 0;
+    uint32_t count = 0;
+    deadline_t timeout;
+
+    deadline_set_ms(&timeout, timeoutMs);
+    while(count < len)
+    {
+        uint32_t n = UartRead(YMODEM_UART, &buf[count], len - count, &lineStatus);
+        if(n != 0)
+        {
+            count += n;
+            deadline_set_ms(&timeout, timeoutMs);
+        }
+        else if(deadline_expired(&timeout))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static int32_t YmodemGetc(uint32_t timeoutMs)
+{
+    uint8_t c;
+
+    return YmodemGetBytes(&c, 1, timeoutMs) ? (int32_t)c : -1;
+}
+
+/* Drop everything until the line is idle, the sender resends after our NAK */
+static void YmodemPurge(void)
+{
+    while(YmodemGetc(YMODEM_PURGE_MS) >= 0) {}
+}
+
+static void YmodemCancel(void)
+{
+    YmodemPurge();
+    YmodemPutc(YMODEM_CAN);
+    YmodemPutc(YMODEM_CAN);
+}
+
+/* Read the rest of a block, E_OK with a valid block number and CRC */
+static int32_t YmodemGetBlock(uint32_t len)
+{
+    if(!YmodemGetBytes(YmodemBlock, len + 4, YMODEM_TIMEOUT_MS))
+    {
+        return E_AGAIN;
+    }
+
+    if((uint8_t)(YmodemBlock[0] ^ YmodemBlock[1]) != 0xFF)
+    {
+        return E_ERROR;
+    }
+
+    uint16_t crc = ((uint16_t)YmodemBlock[len + 2] << 8) | YmodemBlock[len + 3];
+    if(crc16_ccitt(0, &YmodemBlock[2], len) != crc)
+    {
+        return E_ERROR;
+    }
+
+    return E_OK;
+}
+
+/* Header block: "name\0size [mtime mode ...]", an empty name ends the batch */
+static void YmodemParseHeader(ymodem_file_t* file, uint32_t len, uint32_t* size)
+{
+    const char *data = (const char *)&YmodemBlock[2];
+    uint32_t i;
+
+    for(i = 0; i < (YMODEM_NAME_MAX - 1) && i < len && data[i] != '\0'; i++)
+    {
+        file->name[i] = data[i];
+    }
+    file->name[i] = '\0';
+
+    /* Size follows the name terminator, 0 when the sender did not give it */
+    while(i < len && data[i] != '\0')
+    {
+        i++;
+    }
+    *size = 0;
+    if((i + 1) < len)
+    {
+        *size = (uint32_t)strtoul(&data[i + 1], NULL, 10);
+    }
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * YmodemReceive Implementation (See header file for description)
+*/
+int32_t YmodemReceive(ptr_t addr, uint32_t room, ymodem_file_t* file)
+{
+    uint8_t *dst = (uint8_t *)addr;
+    uint8_t reply = YMODEM_CRC;     /* Sent to ask for the next block */
+    uint8_t expected = 0;           /* Next block number */
+    bool_t header = TRUE;           /* Waiting for a YMODEM header block */
+    bool_t started = FALSE;
+    bool_t received = FALSE;        /* File complete, waiting for the batch end */
+    bool_t eot = FALSE;
+    uint32_t size = 0;              /* From the header, 0 if unknown */
+    uint32_t tries = 0;
+    uint32_t errors = 0;
+
+    memset(file, 0, sizeof(ymodem_file_t));
+
+    while(TRUE)
+    {
+        YmodemPutc(reply);
+
+        int32_t c = YmodemGetc(YMODEM_TIMEOUT_MS);
+        switch(c)
+        {
+        case YMODEM_SOH:
+        case YMODEM_STX:
+        {
+            uint32_t len = ((c == YMODEM_SOH) ? (128) : (YMODEM_BLOCK_SIZE));
+            int32_t ret = YmodemGetBlock(len);
+
+            if(ret != E_OK)
+            {
+                if(ret == E_ERROR)
+                {
+                    YmodemPurge();
+                }
+                errors++;
+                file->errors++;
+                reply = ((header) ? (YMODEM_CRC) : (YMODEM_NAK));
+                break;
+            }
+
+            uint8_t block = YmodemBlock[0];
+            started = TRUE;
+            errors = 0;
+            eot = FALSE;
+
+            if(block == 0 && (header || received))
+            {
+                uint32_t headerSize;
+                ymodem_file_t next;
+
+                if(received)
+                {
+                    /* Batch end, anything else would be a second file */
+                    YmodemParseHeader(&next, len, &headerSize);
+                    YmodemPutc(YMODEM_ACK);
+                    if(next.name[0] != '\0')
+                    {
+                        YmodemCancel();
+                    }
+                    return E_OK;
+                }
+
+                YmodemParseHeader(file, len, &size);
+                if(file->name[0] == '\0')
+                {
+                    /* Empty batch */
+                    YmodemPutc(YMODEM_ACK);
+                    return E_AGAIN;
+                }
+                if(size > room)
+                {
+                    YmodemCancel();
+                    return E_NO_MEMORY;
+                }
+
+                header = FALSE;
+                expected = 1;
+                /* Acknowledge and ask for the data in CRC mode */
+                YmodemPutc(YMODEM_ACK);
+                reply = YMODEM_CRC;
+                break;
+            }
+
+            if(header && !received && block == 1)
+            {
+                /* XMODEM sender, no header block */
+                header = FALSE;
+                expected = 1;
+            }
+
+            if(!header && block == expected)
+            {
+                uint32_t copy = len;
+                if(size != 0)
+                {
+                    copy = ((file->size < size) ? (min(len, size - file->size)) : (0));
+                }
+                if(copy > (room - file->size))
+                {
+                    YmodemCancel();
+                    return E_NO_MEMORY;
+                }
+                memcpy(&dst[file->size], &YmodemBlock[2], copy);
+                file->size += copy;
+                file->blocks++;
+                expected++;
+                reply = YMODEM_ACK;
+            }
+            else if(!header && block == (uint8_t)(expected - 1))
+            {
+                /* Our ACK was lost, the sender repeated the block */
+                if(block == 0)
+                {
+                    YmodemPutc(YMODEM_ACK);
+                    reply = YMODEM_CRC;
+                }
+                else
+                {
+                    reply = YMODEM_ACK;
+                }
+            }
+            else
+            {
+                /* Out of sequence, can not recover */
+                YmodemCancel();
+                return E_ERROR;
+            }
+            break;
+        }
+        case YMODEM_EOT:
+        {
+            if(header)
+            {
+                reply = YMODEM_CRC;
+                break;
+            }
+            if(!eot)
+            {
+                /* Make sure it is not noise, a real EOT is sent again */
+                eot = TRUE;
+                reply = YMODEM_NAK;
+                break;
+            }
+
+            YmodemPutc(YMODEM_ACK);
+            if(file->name[0] == '\0')
+            {
+                /* XMODEM ends here */
+                return E_OK;
+            }
+
+            /* YMODEM ends with an empty header block */
+            received = TRUE;
+            header = TRUE;
+            eot = FALSE;
+            reply = YMODEM_CRC;
+            break;
+        }
+        case YMODEM_CAN:
+        {
+            if(YmodemGetc(YMODEM_TIMEOUT_MS) == YMODEM_CAN)
+            {
+                return E_ERROR;
+            }
+            reply = ((header) ? (YMODEM_CRC) : (YMODEM_NAK));
+            break;
+        }
+        case -1:
+        {
+            /* Line silent */
+            if(received)
+            {
+                /* Some senders skip the batch end */
+                return E_OK;
+            }
+            if(!started)
+            {
+                if(++tries >= YMODEM_START_TRIES)
+                {
+                    return E_AGAIN;
+                }
+                break;
+            }
+            errors++;
+            reply = ((header) ? (YMODEM_CRC) : (YMODEM_NAK));
+            break;
+        }
+        default:
+        {
+            YmodemPurge();
+            if(started)
+            {
+                errors++;
+                reply = ((header) ? (YMODEM_CRC) : (YMODEM_NAK));
+            }
+            break;
+        }
+        }
+
+        if(errors >= YMODEM_MAX_ERRORS)
+        {
+            YmodemCancel();
+            return E_AGAIN;
+        }
+    }
+}
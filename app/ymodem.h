@@ -0,0 +1,60 @@
+/**
+ * @file        ymodem.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       XMODEM-1K/YMODEM receiver Header File
+*/
+
+#ifndef YMODEM_H
+#define YMODEM_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported constants ------------------------------------- */
+
+#define YMODEM_NAME_MAX         (64)
+
+#define YMODEM_TIMEOUT_MS       (1000)      /* Wait for a block or a block byte */
+#define YMODEM_START_TRIES      (60)        /* 'C' sent while waiting for the sender */
+#define YMODEM_MAX_ERRORS       (10)        /* Bad blocks in a row before cancelling */
+
+
+/* Exported types ----------------------------------------- */
+
+typedef struct
+{
+    char     name[YMODEM_NAME_MAX];     /* From the header block, empty for XMODEM */
+    uint32_t size;                      /* Bytes stored */
+    uint32_t blocks;                    /* Data blocks accepted */
+    uint32_t errors;                    /* Blocks NAKed */
+}ymodem_file_t;
+
+
+/* Exported functions ------------------------------------- */
+
+/**
+ * @brief	Receive one file with YMODEM (CRC16, 128 or 1K blocks). A sender
+ * 			starting at block 1 is handled as XMODEM-1K, the size is then the
+ * 			received length including the padding
+ * @param	addr - destination
+ * 			room - bytes available at addr
+ * 			file - name, size and statistics of the received file
+ * @retval	E_OK, E_AGAIN if the sender never started or went silent,
+ * 			E_ERROR if the transfer was cancelled, E_NO_MEMORY if the file
+ * 			does not fit (the transfer is cancelled)
+ */
+int32_t YmodemReceive(ptr_t addr, uint32_t room, ymodem_file_t* file);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif // YMODEM_H
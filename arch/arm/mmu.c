@@ -0,0 +1,66 @@
+/**
+ * @file        mmu.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       ARMv7-A MMU identity mapping
+*/
+
+/* Includes ----------------------------------------------- */
+#include <mmu.h>
+
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+#define MMU_SECTION_SHIFT       (20)
+#define MMU_SECTION_ENTRIES     (4096)
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+/* First level table built by boot.S (see linker script) */
+extern uint32_t __mmu_table[MMU_SECTION_ENTRIES];
+
+
+/* Private function prototypes ---------------------------- */
+
+
+
+/* Private functions -------------------------------------- */
+
+void mmu_set_region(uint32_t base, uint32_t size, uint32_t attr)
+{
+    uint32_t first = base >> MMU_SECTION_SHIFT;
+    uint32_t last;
+    uint32_t section;
+
+    if(size == 0)
+    {
+        return;
+    }
+
+    last = (base + size - 1) >> MMU_SECTION_SHIFT;
+
+    // Caches may hold data of a region that becomes uncacheable
+    if(attr != MMU_SECTION_NORMAL)
+    {
+        dcache_clean_invalidate_range(base, size);
+    }
+
+    for(section = first; section <= last && section < MMU_SECTION_ENTRIES; ++section)
+    {
+        __mmu_table[section] = (section << MMU_SECTION_SHIFT) | attr;
+    }
+
+    // Make the new entries visible to the table walker
+    dcache_clean_range((uint32_t)&__mmu_table[first], (section - first) * sizeof(uint32_t));
+    tlb_invalidate_all();
+}
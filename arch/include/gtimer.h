@@ -0,0 +1,43 @@
+/**
+ * @file        gtimer.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       ARMv7-A Generic Timer Header File
+*/
+
+#ifndef _GTIMER_H_
+#define _GTIMER_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+/* Exported types ----------------------------------------- */
+
+
+/* Exported constants ------------------------------------- */
+
+#define GTIMER_DEFAULT_FREQ     (24000000)  // H3 system counter runs from the 24MHz oscillator
+
+
+/* Exported macros ---------------------------------------- */
+
+
+/* Exported functions ------------------------------------- */
+
+uint64_t gtimer_get_count(void);
+
+uint32_t gtimer_get_freq(void);
+
+void gtimer_set_freq(uint32_t freq);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _GTIMER_H_ */
@@ -32,9 +32,9 @@
 #define readl(addr)			(*((volatile ulong_t *)(addr)))
 #define writel(v, addr)		(*((volatile ulong_t *)(addr)) = (ulong_t)(v))
 
-#define dsb()				asm volatile("dsb")
-#define dmb()				asm volatile("dmb")
-#define isb()				asm volatile("isb")
+#define dsb()				asm volatile("dsb" : : : "memory")
+#define dmb()				asm volatile("dmb" : : : "memory")
+#define isb()				asm volatile("isb" : : : "memory")
 
 /* Exported functions ------------------------------------- */
 
@@ -0,0 +1,71 @@
+/**
+ * @file        mmu.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       ARMv7-A MMU and Cache Maintenance Header File
+*/
+
+#ifndef _MMU_H_
+#define _MMU_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+/* Exported types ----------------------------------------- */
+
+
+/* Exported constants ------------------------------------- */
+
+#define MMU_SECTION_SIZE            (0x100000)
+
+/* Short-descriptor section attributes (identity mapping, full access) */
+#define MMU_SECTION_NORMAL          (0x00001C0E)    // TEX=001 C=1 B=1: write-back write-allocate
+#define MMU_SECTION_STRONGLY_ORDERED (0x00000C12)   // TEX=000 C=0 B=0, XN
+
+/* Exported macros ---------------------------------------- */
+
+
+/* Exported functions ------------------------------------- */
+
+/**
+ * @brief   Change the attributes of the sections covering [base, base + size)
+ * @param   base - physical (and virtual) start address
+ *          size - region size in bytes
+ *          attr - MMU_SECTION_* attributes
+ * @retval  No return value
+ */
+void mmu_set_region(uint32_t base, uint32_t size, uint32_t attr);
+
+/**
+ * @brief   Clean and invalidate all data caches, then disable caches, branch
+ *          prediction and MMU. Used before handing off to the next stage.
+ */
+void mmu_disable(void);
+
+/* Range based maintenance by MVA (start and size in bytes) */
+void dcache_clean_range(uint32_t start, uint32_t size);
+
+void dcache_invalidate_range(uint32_t start, uint32_t size);
+
+void dcache_clean_invalidate_range(uint32_t start, uint32_t size);
+
+/* Whole cache maintenance by set/way */
+void dcache_invalidate_all(void);
+
+void dcache_clean_invalidate_all(void);
+
+void icache_invalidate_all(void);
+
+void tlb_invalidate_all(void);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _MMU_H_ */
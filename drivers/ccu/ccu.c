@@ -136,4 +136,42 @@ uint32_t clock_get_pll6(void)
     int k = ((rval & CCM_PLL6_CTRL_K_MASK) >> CCM_PLL6_CTRL_K_SHIFT) + 1;
 
     return 24000000 * n * k / 2;
-}
\ No newline at end of file
+}
+
+void clock_set_apb2(uint32_t cfg)
+{
+    uint32_t rval = readl(APB2_CFG_REG);
+
+    // Dividers first on the current source, then switch the source
+    rval &= ~(APB2_CLK_RATE_N_MASK | APB2_CLK_RATE_M_MASK);
+    rval |= (cfg & (APB2_CLK_RATE_N_MASK | APB2_CLK_RATE_M_MASK));
+    writel(rval, APB2_CFG_REG);
+
+    rval &= ~APB2_CLK_SRC_MASK;
+    rval |= (cfg & APB2_CLK_SRC_MASK);
+    writel(rval, APB2_CFG_REG);
+}
+
+uint32_t clock_get_apb2(void)
+{
+    uint32_t rval = readl(APB2_CFG_REG);
+    uint32_t src;
+
+    switch(rval & APB2_CLK_SRC_MASK)
+    {
+    case APB2_CLK_SRC_LOSC:
+        src = 32768;
+        break;
+    case APB2_CLK_SRC_OSC24M:
+        src = 24000000;
+        break;
+    default:
+        src = clock_get_pll6();
+        break;
+    }
+
+    uint32_t n = 1 << ((rval & APB2_CLK_RATE_N_MASK) >> 16);
+    uint32_t m = (rval & APB2_CLK_RATE_M_MASK) + 1;
+
+    return src / n / m;
+}
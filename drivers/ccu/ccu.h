@@ -118,6 +118,10 @@ void clock_set_pll5(unsigned int clk, bool_t sigma_delta_enable);
 
 uint32_t clock_get_pll6(void);
 
+void clock_set_apb2(uint32_t cfg);
+
+uint32_t clock_get_apb2(void);
+
 
 #ifdef __cplusplus
     }
@@ -269,6 +269,9 @@ struct sunxi_ccm_reg {
 #define AHB1_ABP1_DIV_DEFAULT		0x00003180 /* AHB1=PLL6/3,APB1=AHB1/2 */
 #endif
 
+/* APB2=PLL6/5=120MHz: UART divisors within 2% up to 1.5Mbaud */
+#define APB2_DIV_DEFAULT		(APB2_CLK_SRC_PLL6 | APB2_CLK_RATE_N_1 | APB2_CLK_RATE_M(5))
+
 #define AXI_GATE_OFFSET_DRAM		0
 
 /* ahb_gate0 offsets */
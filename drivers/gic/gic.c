@@ -0,0 +1,196 @@
+/**
+ * @file        gic.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       GICv2 interrupt controller driver
+*/
+
+
+
+/* Includes ----------------------------------------------- */
+#include <gic.h>
+#include <misc.h>
+
+/* Private types ------------------------------------------ */
+
+typedef struct
+{
+	volatile uint32_t ctlr;				/* 000 - distributor control */
+	volatile uint32_t typer;			/* 004 - interrupt controller type */
+	volatile uint32_t iidr;				/* 008 - implementer identification */
+	volatile uint32_t res0[29];
+	volatile uint32_t igroupr[32];		/* 080 - interrupt group */
+	volatile uint32_t isenabler[32];	/* 100 - interrupt set-enable */
+	volatile uint32_t icenabler[32];	/* 180 - interrupt clear-enable */
+	volatile uint32_t ispendr[32];		/* 200 - interrupt set-pending */
+	volatile uint32_t icpendr[32];		/* 280 - interrupt clear-pending */
+	volatile uint32_t isactiver[32];	/* 300 - interrupt set-active */
+	volatile uint32_t icactiver[32];	/* 380 - interrupt clear-active */
+	volatile uint8_t  ipriorityr[1024];	/* 400 - interrupt priority */
+	volatile uint8_t  itargetsr[1024];	/* 800 - interrupt processor targets */
+	volatile uint32_t icfgr[64];		/* C00 - interrupt configuration */
+}gic_dist_t;
+
+typedef struct
+{
+	volatile uint32_t ctlr;				/* 00 - cpu interface control */
+	volatile uint32_t pmr;				/* 04 - priority mask */
+	volatile uint32_t bpr;				/* 08 - binary point */
+	volatile uint32_t iar;				/* 0c - interrupt acknowledge */
+	volatile uint32_t eoir;				/* 10 - end of interrupt */
+}gic_cpu_t;
+
+
+/* Private constants -------------------------------------- */
+
+#define SUNXI_GICD_BASE		(0x01C81000)
+#define SUNXI_GICC_BASE		(0x01C82000)
+
+#define GICD_CTLR_ENABLE	(0x1)
+#define GICC_CTLR_ENABLE	(0x1)
+
+#define GICC_PMR_ALL		(0xF0)	/* Let every priority through */
+#define GIC_PRIORITY_IRQ	(0xA0)
+#define GIC_TARGET_CPU0		(0x01)
+
+#define GICC_IAR_ID_MASK	(0x3FF)
+#define GIC_SPURIOUS		(1020)	/* IDs 1020 to 1023 are special */
+
+
+/* Private macros ----------------------------------------- */
+
+#define GICD				((gic_dist_t *)SUNXI_GICD_BASE)
+#define GICC				((gic_cpu_t *)SUNXI_GICC_BASE)
+
+
+/* Private variables -------------------------------------- */
+
+static gic_handler_t GicHandlers[GIC_IRQ_COUNT];
+
+
+/* Private function prototypes ---------------------------- */
+
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * GicInit Implementation (See header file for description)
+*/
+void GicInit(void)
+{
+    uint32_t i;
+
+    GICD->ctlr = 0;
+    GICC->ctlr = 0;
+
+    for(i = 0; i < (GIC_IRQ_COUNT / 32); i++)
+    {
+        GICD->icenabler[i] = 0xFFFFFFFF;
+        GICD->icpendr[i] = 0xFFFFFFFF;
+        /* Group 0, signalled as IRQ while FIQEn is clear */
+        GICD->igroupr[i] = 0;
+    }
+
+    for(i = 0; i < GIC_IRQ_COUNT; i++)
+    {
+        GicHandlers[i] = NULL;
+        GICD->ipriorityr[i] = GIC_PRIORITY_IRQ;
+        /* Targets of SGIs and PPIs are read only */
+        if(i >= GIC_SPI(0))
+        {
+            GICD->itargetsr[i] = GIC_TARGET_CPU0;
+        }
+    }
+
+    /* Level sensitive shared interrupts */
+    for(i = (GIC_SPI(0) / 16); i < (GIC_IRQ_COUNT / 16); i++)
+    {
+        GICD->icfgr[i] = 0;
+    }
+
+    GICC->pmr = GICC_PMR_ALL;
+    GICC->bpr = 0;
+
+    GICD->ctlr = GICD_CTLR_ENABLE;
+    GICC->ctlr = GICC_CTLR_ENABLE;
+    dsb();
+}
+
+/**
+ * GicDisable Implementation (See header file for description)
+*/
+void GicDisable(void)
+{
+    uint32_t i;
+
+    for(i = 0; i < (GIC_IRQ_COUNT / 32); i++)
+    {
+        GICD->icenabler[i] = 0xFFFFFFFF;
+    }
+
+    GICC->ctlr = 0;
+    GICD->ctlr = 0;
+    dsb();
+}
+
+/**
+ * GicEnableIrq Implementation (See header file for description)
+*/
+int32_t GicEnableIrq(uint32_t irq, gic_handler_t handler)
+{
+    if(irq >= GIC_IRQ_COUNT || handler == NULL)
+    {
+        return E_INVAL;
+    }
+
+    GicHandlers[irq] = handler;
+    dsb();
+    GICD->isenabler[irq / 32] = (1 << (irq % 32));
+
+    return E_OK;
+}
+
+/**
+ * GicDisableIrq Implementation (See header file for description)
+*/
+void GicDisableIrq(uint32_t irq)
+{
+    if(irq >= GIC_IRQ_COUNT)
+    {
+        return;
+    }
+
+    GICD->icenabler[irq / 32] = (1 << (irq % 32));
+    dsb();
+}
+
+/**
+ * GicHandleIrq Implementation (See header file for description)
+*/
+void GicHandleIrq(void)
+{
+    while(1)
+    {
+        uint32_t iar = GICC->iar;
+        uint32_t irq = iar & GICC_IAR_ID_MASK;
+
+        if(irq >= GIC_SPURIOUS)
+        {
+            break;
+        }
+
+        if(irq < GIC_IRQ_COUNT && GicHandlers[irq] != NULL)
+        {
+            GicHandlers[irq](irq);
+        }
+        else
+        {
+            /* Unexpected source, keep it from firing again */
+            GicDisableIrq(irq);
+        }
+
+        GICC->eoir = iar;
+    }
+}
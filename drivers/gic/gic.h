@@ -0,0 +1,88 @@
+/**
+ * @file        gic.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       GICv2 interrupt controller driver header file
+*/
+
+#ifndef _GIC_H_
+#define _GIC_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported types ----------------------------------------- */
+
+typedef void (*gic_handler_t)(uint32_t irq);
+
+
+/* Exported constants ------------------------------------- */
+
+#define GIC_IRQ_COUNT		(160)	/* 32 SGI/PPI + 128 SPI */
+#define GIC_SPI(n)			(32 + (n))
+
+/* H3 shared peripheral interrupts */
+#define UART0_IRQ			GIC_SPI(0)
+#define UART1_IRQ			GIC_SPI(1)
+#define UART2_IRQ			GIC_SPI(2)
+#define UART3_IRQ			GIC_SPI(3)
+
+
+/* Exported macros ---------------------------------------- */
+
+#define irq_enable()		asm volatile("cpsie i" : : : "memory")
+#define irq_disable()		asm volatile("cpsid i" : : : "memory")
+
+
+/* Exported functions ------------------------------------- */
+
+/**
+ * @brief	Initialize the distributor and the cpu interface, all interrupts
+ * 			are disabled and routed to core 0 as IRQ
+ * @param	No parameters
+ * @retval	No return value
+ */
+void GicInit(void);
+
+/**
+ * @brief	Disable the distributor and the cpu interface
+ * @param	No parameters
+ * @retval	No return value
+ */
+void GicDisable(void);
+
+/**
+ * @brief	Install the handler and enable the interrupt
+ * @param	irq - interrupt ID
+ * 			handler - function called from the IRQ exception
+ * @retval	E_OK or E_INVAL
+ */
+int32_t GicEnableIrq(uint32_t irq, gic_handler_t handler);
+
+/**
+ * @brief	Disable the interrupt
+ * @param	irq - interrupt ID
+ * @retval	No return value
+ */
+void GicDisableIrq(uint32_t irq);
+
+/**
+ * @brief	IRQ exception handler, acknowledges and dispatches the pending
+ * 			interrupts (called from the vector in boot.S)
+ * @param	No parameters
+ * @retval	No return value
+ */
+void GicHandleIrq(void);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _GIC_H_ */
@@ -26,6 +26,19 @@
 #define CONFIG_SYS_MMC_MAX_BLK_COUNT 65535
 #endif
 
+/* CMD23 carries the block count in 16 bits */
+#define MMC_SBC_MAX_BLK_COUNT   (0xFFFF)
+
+/* Erase is issued in ranges of at most 1GB so each one completes in bounded time */
+#define MMC_ERASE_MAX_BLOCKS    (0x200000)
+#define MMC_ERASE_TIMEOUT_MS    (30000)
+
+/* A card left in data state by a broken transfer is back in TRAN well within this */
+#define MMC_RECOVER_TIMEOUT_MS  (100)
+
+/* Write fallback for partial erase groups or cards without erase support */
+#define MMC_ERASE_FILL_BLOCKS   (8)
+
 /* Private macros ----------------------------------------- */
 
 #define __be32_to_cpu(x)    ((0x000000ff&((x)>>24)) | (0x0000ff00&((x)>>8)) |   \
@@ -35,6 +48,9 @@
 
 static struct mmc* mmc_devices[MAX_MMC_NUM];
 
+/* Filled with the erased value of the card before each use */
+static uint8_t mmc_fill_blocks[MMC_ERASE_FILL_BLOCKS * 512] __attribute__ ((aligned (64)));
+
 /* frequency bases */
 /* divided by 10 to be nice to platforms without floating point */
 static const int fbase[] =
@@ -75,9 +91,11 @@ static int32_t mmc_send_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_dat
     return mmc->send_cmd(mmc, cmd, data);
 }
 
-static int32_t mmc_send_status(struct mmc* mmc, int32_t timeout)
+/* Poll until the card is ready for data and in state (MMC_STATE_ANY: out of PRG) */
+static int32_t mmc_send_status(struct mmc* mmc, uint32_t state, int32_t timeout)
 {
     struct mmc_cmd cmd;
+    deadline_t deadline;
     int32_t err;
 
     cmd.cmdidx    = MMC_CMD_SEND_STATUS;
@@ -85,7 +103,10 @@ static int32_t mmc_send_status(struct mmc* mmc, int32_t timeout)
     cmd.cmdarg    = mmc->rca << 16;
     cmd.flags     = 0;
 
-    do
+    // timeout is in milliseconds, the card is polled back to back
+    deadline_set_ms(&deadline, timeout);
+
+    while(1)
     {
         err = mmc_send_cmd(mmc, &cmd, NULL);
         if (err != 0)
@@ -93,22 +114,22 @@ static int32_t mmc_send_status(struct mmc* mmc, int32_t timeout)
             return err;
         }
         
-        if(cmd.response[0] & MMC_STATUS_RDY_FOR_DATA)
+        uint32_t current = cmd.response[0] & MMC_STATUS_CURR_STATE;
+        if((cmd.response[0] & MMC_STATUS_RDY_FOR_DATA) && current != MMC_STATE_PRG &&
+           (state == MMC_STATE_ANY || current == state))
         {
             break;
         }
 
-        delay_us(1000);
-
         if (cmd.response[0] & MMC_STATUS_MASK)
         {
             return COMM_ERR;
         }
-    } while(timeout--);
 
-    if (!timeout)
-    {
-        return TIMEOUT;
+        if (deadline_expired(&deadline))
+        {
+            return TIMEOUT;
+        }
     }
 
     return E_OK;
@@ -126,7 +147,7 @@ static int32_t mmc_set_blocklen(struct mmc* mmc, int32_t len)
     return mmc_send_cmd(mmc, &cmd, NULL);
 }
 
-static ulong_t mmc_erase_t(struct mmc* mmc, ulong_t start, uint32_t blkcnt)
+static int32_t mmc_erase_t(struct mmc* mmc, ulong_t start, uint32_t blkcnt)
 {
     struct mmc_cmd cmd;
     ulong_t end;
@@ -173,9 +194,14 @@ static ulong_t mmc_erase_t(struct mmc* mmc, ulong_t start, uint32_t blkcnt)
         return err;
     }
 
+    /*
+     * Plain erase, the card only marks the range as erased.
+     * The host busy wait is too short for a large range, so
+     * take an R1 response and poll the card status instead.
+     */
     cmd.cmdidx    = MMC_CMD_ERASE;
-    cmd.cmdarg    = SECURE_ERASE;
-    cmd.resp_type = MMC_RSP_R1b;
+    cmd.cmdarg    = MMC_ERASE_ARG;
+    cmd.resp_type = MMC_RSP_R1;
 
     err = mmc_send_cmd(mmc, &cmd, NULL);
     if(err)
@@ -183,93 +209,269 @@ static ulong_t mmc_erase_t(struct mmc* mmc, ulong_t start, uint32_t blkcnt)
         return err;
     }
 
-    return E_OK;
+    /* RDY_FOR_DATA can be set while the erase is still programming */
+    return mmc_send_status(mmc, MMC_STATE_TRAN, MMC_ERASE_TIMEOUT_MS);
 }
 
-static ulong_t mmc_write_blocks(struct mmc* mmc, ulong_t start, uint32_t blkcnt, const void* src)
+/* Write blocks with the value erased blocks read back as */
+static ulong_t mmc_fill_blocks_write(struct mmc* mmc, int32_t dev_num, ulong_t start, uint32_t blkcnt)
 {
-    struct mmc_cmd cmd;
-    struct mmc_data data;
-    int32_t timeout = 1000;
+    uint32_t cur, blocks_todo = blkcnt;
 
-    if((start + blkcnt) > mmc->lba)
+    memset(mmc_fill_blocks, mmc->erased_byte, sizeof(mmc_fill_blocks));
+
+    while(blocks_todo > 0)
     {
-        return 0;
+        cur = ((blocks_todo > MMC_ERASE_FILL_BLOCKS) ? (MMC_ERASE_FILL_BLOCKS) : (blocks_todo));
+        if(mmc_bwrite(dev_num, start, cur, mmc_fill_blocks) != cur)
+        {
+            return 0;
+        }
+        blocks_todo -= cur;
+        start += cur;
     }
 
-    cmd.cmdidx = ((blkcnt > 1) ? (MMC_CMD_WRITE_MULTIPLE_BLOCK) : (MMC_CMD_WRITE_SINGLE_BLOCK));
-    cmd.cmdarg = ((mmc->high_capacity) ? (start) : (start * mmc->write_bl_len));
+    return blkcnt;
+}
+
+static int32_t mmc_set_block_count(struct mmc* mmc, uint32_t blkcnt)
+{
+    struct mmc_cmd cmd;
+
+    cmd.cmdidx    = MMC_CMD_SET_BLOCK_COUNT;
+    cmd.cmdarg    = blkcnt & MMC_SBC_MAX_BLK_COUNT;
     cmd.resp_type = MMC_RSP_R1;
     cmd.flags     = 0;
 
-    data.src     = src;
-    data.blocks    = blkcnt;
-    data.blocksize = mmc->write_bl_len;
-    data.flags     = MMC_DATA_WRITE;
+    return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
+static int32_t mmc_stop_transmission(struct mmc* mmc)
+{
+    struct mmc_cmd cmd;
 
-    if(mmc_send_cmd(mmc, &cmd, &data))
+    cmd.cmdidx    = MMC_CMD_STOP_TRANSMISSION;
+    cmd.cmdarg    = 0;
+    cmd.resp_type = MMC_RSP_R1b;
+    cmd.flags     = 0;
+
+    return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
+/*
+ * Multi-block transfers are ended one way only: CMD23 when the card
+ * takes it, otherwise the host auto stop, and an explicit CMD12 only
+ * on hosts without auto stop. The host waits for the card busy after
+ * writes, so no status poll is needed between transfers.
+ */
+static int32_t mmc_rw_prepare(struct mmc* mmc, struct mmc_cmd* cmd, ulong_t start, struct mmc_data* data)
+{
+    int32_t write = (data->flags & MMC_DATA_WRITE);
+
+    if (data->blocks > 1)
     {
-        return 0;
+        if (mmc->card_caps & MMC_MODE_CMD23)
+        {
+            if (mmc_set_block_count(mmc, data->blocks))
+            {
+                return -1;
+            }
+            data->flags |= MMC_DATA_PREDEFINED;
+        }
+
+        cmd->cmdidx = ((write) ? (MMC_CMD_WRITE_MULTIPLE_BLOCK) : (MMC_CMD_READ_MULTIPLE_BLOCK));
+    }
+    else
+    {
+        cmd->cmdidx = ((write) ? (MMC_CMD_WRITE_SINGLE_BLOCK) : (MMC_CMD_READ_SINGLE_BLOCK));
+    }
+
+    cmd->cmdarg    = ((mmc->high_capacity) ? (start) : (start * data->blocksize));
+    cmd->resp_type = MMC_RSP_R1;
+    cmd->flags     = 0;
+
+    return E_OK;
+}
+
+static int32_t mmc_rw_finish(struct mmc* mmc, struct mmc_data* data, int32_t err)
+{
+    if (err)
+    {
+        // Bring the card back to transfer state after a broken transfer
+        if (data->blocks > 1)
+        {
+            (void)mmc_stop_transmission(mmc);
+        }
+        return -1;
     }
 
     /* SPI multiblock writes terminate using a special
      * token, not a STOP_TRANSMISSION request.
      */
-    if (!mmc_host_is_spi(mmc) && blkcnt > 1)
+    if ((data->blocks > 1) && !(data->flags & MMC_DATA_PREDEFINED) &&
+        !(mmc->cfg->host_caps & (MMC_MODE_AUTO_STOP | MMC_MODE_SPI)))
     {
-        cmd.cmdidx    = MMC_CMD_STOP_TRANSMISSION;
-        cmd.cmdarg    = 0;
-        cmd.resp_type = MMC_RSP_R1b;
-        cmd.flags     = 0;
-        if(mmc_send_cmd(mmc, &cmd, NULL))
-        {
-            return 0;
-        }
+        return mmc_stop_transmission(mmc);
     }
 
-    /* Waiting for the ready status */
-    mmc_send_status(mmc, timeout);
+    return E_OK;
+}
+
+static int32_t mmc_rw_blocks(struct mmc* mmc, ulong_t start, struct mmc_data* data)
+{
+    struct mmc_cmd cmd;
+
+    if (mmc_rw_prepare(mmc, &cmd, start, data))
+    {
+        return -1;
+    }
+
+    return mmc_rw_finish(mmc, data, mmc_send_cmd(mmc, &cmd, data));
+}
+
+static ulong_t mmc_write_blocks(struct mmc* mmc, ulong_t start, uint32_t blkcnt, const void* src)
+{
+    struct mmc_data data;
+
+    if((start + blkcnt) > mmc->lba)
+    {
+        return 0;
+    }
+
+    data.src       = src;
+    data.blocks    = blkcnt;
+    data.blocksize = mmc->write_bl_len;
+    data.flags     = MMC_DATA_WRITE;
+
+    if(mmc_rw_blocks(mmc, start, &data))
+    {
+        return 0;
+    }
 
     return blkcnt;
 }
 
 static int32_t mmc_read_blocks(struct mmc* mmc, void* dst, ulong_t start, uint32_t blkcnt)
 {
-    struct mmc_cmd cmd;
     struct mmc_data data;
-    int32_t timeout = 1000;
 
-    cmd.cmdidx = ((blkcnt > 1) ? (MMC_CMD_READ_MULTIPLE_BLOCK) : (MMC_CMD_READ_SINGLE_BLOCK));
-    cmd.cmdarg = ((mmc->high_capacity) ? (start) : (start * mmc->read_bl_len));
-    cmd.resp_type = MMC_RSP_R1;
-    cmd.flags     = 0;
-
-    data.dest    = dst;
+    data.dest      = dst;
     data.blocks    = blkcnt;
     data.blocksize = mmc->read_bl_len;
     data.flags     = MMC_DATA_READ;
 
-    if(mmc_send_cmd(mmc, &cmd, &data))
+    if(mmc_rw_blocks(mmc, start, &data))
     {
         return 0;
     }
 
-    if(blkcnt > 1)
+    return blkcnt;
+}
+
+/* Complete the head request and move on to the next one */
+static void mmc_req_complete(struct mmc* mmc, int32_t status)
+{
+    struct mmc_req* req = mmc->req_head;
+
+    mmc->req_head = req->next;
+    if (mmc->req_head == NULL)
     {
-        cmd.cmdidx    = MMC_CMD_STOP_TRANSMISSION;
-        cmd.cmdarg    = 0;
-        cmd.resp_type = MMC_RSP_R1b;
-        cmd.flags     = 0;
-        if(mmc_send_cmd(mmc, &cmd, NULL))
+        mmc->req_tail = NULL;
+    }
+
+    req->next = NULL;
+    req->status = status;
+}
+
+/* Start the next chunk of the head request, E_BUSY while one is in flight */
+static int32_t mmc_req_issue(struct mmc* mmc)
+{
+    struct mmc_req* req;
+    struct mmc_data* data = &mmc->req_data;
+    uint32_t bl_len;
+    int32_t err;
+
+    while ((req = mmc->req_head) != NULL)
+    {
+        bl_len = ((req->flags & MMC_DATA_WRITE) ? (mmc->write_bl_len) : (mmc->read_bl_len));
+
+        data->dest      = (char*)req->dst + (req->done * bl_len);
+        data->blocks    = (((req->blkcnt - req->done) > mmc->b_max) ? (mmc->b_max) : (req->blkcnt - req->done));
+        data->blocksize = bl_len;
+        data->flags     = req->flags;
+
+        err = mmc_rw_prepare(mmc, &mmc->req_cmd, req->start + req->done, data);
+        if (!err)
         {
-            return 0;
+            err = mmc->start_cmd(mmc, &mmc->req_cmd, data);
+            if (!err)
+            {
+                return E_BUSY;
+            }
+            (void)mmc_rw_finish(mmc, data, err);
         }
 
-        /* Waiting for the ready status */
-        mmc_send_status(mmc, timeout);
+        mmc_req_complete(mmc, E_FAULT);
     }
 
-    return blkcnt;
+    return E_OK;
+}
+
+static int32_t mmc_req_submit(int32_t dev_num, struct mmc_req* req)
+{
+    struct mmc* mmc = find_mmc_device(dev_num);
+    ulong_t done;
+
+    if (!req)
+    {
+        return E_INVAL;
+    }
+
+    if (!mmc || req->blkcnt == 0 || ((req->start + req->blkcnt) > mmc->lba))
+    {
+        req->status = E_INVAL;
+        return E_INVAL;
+    }
+
+    req->done = 0;
+    req->next = NULL;
+    req->status = E_BUSY;
+
+    // Hosts that can't split a command complete the request right here
+    if (!mmc->start_cmd || !mmc->poll_cmd)
+    {
+        done = ((req->flags & MMC_DATA_WRITE) ? (mmc_bwrite(dev_num, req->start, req->blkcnt, req->src)) :
+                                                (mmc_bread(dev_num, req->start, req->blkcnt, req->dst)));
+        req->done = done;
+        req->status = ((done == req->blkcnt) ? (E_OK) : (E_FAULT));
+        return E_OK;
+    }
+
+    if (mmc->req_tail)
+    {
+        mmc->req_tail->next = req;
+        mmc->req_tail = req;
+        return E_OK;
+    }
+
+    // The block length can only change while the bus is idle
+    if (mmc_set_blocklen(mmc, ((req->flags & MMC_DATA_WRITE) ? (mmc->write_bl_len) : (mmc->read_bl_len))))
+    {
+        req->status = E_FAULT;
+        return E_OK;
+    }
+
+    mmc->req_head = mmc->req_tail = req;
+    (void)mmc_req_issue(mmc);
+
+    return E_OK;
+}
+
+/* Synchronous access waits for the queued requests first */
+static void mmc_req_drain(int32_t dev_num)
+{
+    while (mmc_poll(dev_num) == E_BUSY)
+        ;
 }
 
 static int32_t mmc_go_idle(struct mmc* mmc)
@@ -486,7 +688,7 @@ static int32_t mmc_switch(struct mmc* mmc, uint8_t set, uint8_t index, uint8_t v
     ret = mmc_send_cmd(mmc, &cmd, NULL);
 
     /* Waiting for the ready status */
-    mmc_send_status(mmc, timeout);
+    mmc_send_status(mmc, MMC_STATE_ANY, timeout);
 
     return ret;
 }
@@ -499,6 +701,12 @@ static int32_t mmc_change_freq(struct mmc* mmc)
 
     mmc->card_caps = 0;
 
+    /* SET_BLOCK_COUNT is mandatory since MMC 3.1 */
+    if (mmc->version >= MMC_VERSION_3)
+    {
+        mmc->card_caps |= MMC_MODE_CMD23;
+    }
+
     /* Only version 4 supports high-speed */
     if (mmc_host_is_spi(mmc) || (mmc->version < MMC_VERSION_4))
     {
@@ -660,6 +868,13 @@ retry_scr:
         mmc->card_caps |= MMC_MODE_4BIT;
     }
 
+    if (mmc->scr[0] & SD_CMD23_SUPPORT)
+    {
+        mmc->card_caps |= MMC_MODE_CMD23;
+    }
+
+    mmc->erased_byte = ((mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE) ? (0xFF) : (0x00));
+
     /* Version 1.0 doesn't support switching */
     if (mmc->version == SD_VERSION_1_0)
     {
@@ -792,7 +1007,7 @@ static int32_t mmc_startup(struct mmc* mmc)
     err = mmc_send_cmd(mmc, &cmd, NULL);
 
     /* Waiting for the ready status */
-    mmc_send_status(mmc, timeout);
+    mmc_send_status(mmc, MMC_STATE_ANY, timeout);
 
     if (err)
     {
@@ -894,6 +1109,7 @@ static int32_t mmc_startup(struct mmc* mmc)
      * For SD, its erase group is always one sector
      */
     mmc->erase_grp_size = 1;
+    mmc->erased_byte = 0x00;
     mmc->part_config = MMCPART_NOAVAILABLE;
     if (!IS_SD(mmc) && (mmc->version >= MMC_VERSION_4))
     {
@@ -922,7 +1138,7 @@ static int32_t mmc_startup(struct mmc* mmc)
          */
         if (ext_csd[175])
         {
-            mmc->erase_grp_size = ext_csd[224] * 512 * 1024;
+            mmc->erase_grp_size = ext_csd[224] * 1024;  /* 512KB units in blocks */
         }
         else
         {
@@ -932,6 +1148,11 @@ static int32_t mmc_startup(struct mmc* mmc)
             mmc->erase_grp_size = (erase_gsz + 1) * (erase_gmul + 1);
         }
 
+        if (!err)
+        {
+            mmc->erased_byte = ((ext_csd[EXT_CSD_ERASED_MEM_CONT] & 0x1) ? (0xFF) : (0x00));
+        }
+
         /* store the partition info of emmc */
         if (ext_csd[160] & PART_SUPPORT)
         {
@@ -1047,6 +1268,13 @@ static int32_t mmc_startup(struct mmc* mmc)
     //mmc->lba = mmc->capacity/mmc->read_bl_len;
     mmc->lba = mmc->capacity >> 9;		//consider mmc->read_bl_len as int 9
 
+    /* Largest chunk one data command can carry on this host and card */
+    mmc->b_max = ((mmc->cfg->max_req_size) ? (mmc->cfg->max_req_size / mmc->read_bl_len) : (CONFIG_SYS_MMC_MAX_BLK_COUNT));
+    if ((mmc->card_caps & MMC_MODE_CMD23) && (mmc->b_max > MMC_SBC_MAX_BLK_COUNT))
+    {
+        mmc->b_max = MMC_SBC_MAX_BLK_COUNT;
+    }
+
     return E_OK;
 }
 
@@ -1150,21 +1378,81 @@ struct mmc* find_mmc_device(int32_t dev_num)
     return NULL;
 }
 
-int32_t mmc_berase(int32_t dev_num, ulong_t start, uint32_t blkcnt)
+int32_t mmc_recover(int32_t dev_num)
 {
-    int32_t err = 0;
-    struct mmc *mmc = find_mmc_device(dev_num);
-    void* src = (void*)0x41000000;  //TODO: !!!!!!!!!!!!!!!!!!!!!
+    struct mmc* mmc = find_mmc_device(dev_num);
 
     if (!mmc)
     {
         return -1;
     }
 
-    memset(src, 0, 512 * blkcnt);
-    err = mmc_bwrite(dev_num, start, blkcnt, src);
+    mmc_req_drain(dev_num);
 
-    return err;
+    // Stop a read the card may still be sending
+    if (mmc_send_status(mmc, MMC_STATE_TRAN, MMC_RECOVER_TIMEOUT_MS))
+    {
+        (void)mmc_stop_transmission(mmc);
+        return mmc_send_status(mmc, MMC_STATE_TRAN, MMC_RECOVER_TIMEOUT_MS);
+    }
+
+    return E_OK;
+}
+
+int32_t mmc_berase(int32_t dev_num, ulong_t start, uint32_t blkcnt)
+{
+    struct mmc *mmc = find_mmc_device(dev_num);
+    ulong_t first, last, end;
+    uint32_t grp, cur;
+
+    mmc_req_drain(dev_num);
+
+    if (blkcnt == 0 || !mmc || (start + blkcnt) > mmc->lba)
+    {
+        return 0;
+    }
+
+    // Without erase command class support the whole range is written
+    if (!(mmc->csd[1] & MMC_CSD_CCC_ERASE))
+    {
+        return mmc_fill_blocks_write(mmc, dev_num, start, blkcnt);
+    }
+
+    /*
+     * Only whole erase groups can be erased, the partial groups
+     * at either end are written with the erased value instead
+     */
+    grp   = mmc->erase_grp_size;
+    end   = start + blkcnt;
+    first = ((start + grp - 1) / grp) * grp;
+    last  = (end / grp) * grp;
+
+    if (first >= last)
+    {
+        return mmc_fill_blocks_write(mmc, dev_num, start, blkcnt);
+    }
+
+    if ((first > start) && (mmc_fill_blocks_write(mmc, dev_num, start, first - start) == 0))
+    {
+        return 0;
+    }
+
+    while (first < last)
+    {
+        cur = (((last - first) > MMC_ERASE_MAX_BLOCKS) ? (MMC_ERASE_MAX_BLOCKS - (MMC_ERASE_MAX_BLOCKS % grp)) : (last - first));
+        if (mmc_erase_t(mmc, first, cur))
+        {
+            return 0;
+        }
+        first += cur;
+    }
+
+    if ((end > last) && (mmc_fill_blocks_write(mmc, dev_num, last, end - last) == 0))
+    {
+        return 0;
+    }
+
+    return blkcnt;
 }
 
 ulong_t mmc_bwrite(int32_t dev_num, ulong_t start, uint32_t blkcnt, const void* src)
@@ -1173,6 +1461,8 @@ ulong_t mmc_bwrite(int32_t dev_num, ulong_t start, uint32_t blkcnt, const void*
 
     struct mmc* mmc = find_mmc_device(dev_num);
 
+    mmc_req_drain(dev_num);
+
     if (blkcnt == 0 || !mmc || mmc_set_blocklen(mmc, mmc->write_bl_len))
     {
         return 0;
@@ -1199,6 +1489,8 @@ ulong_t mmc_bread(int32_t dev_num, ulong_t start, uint32_t blkcnt, void* dst)
     uint32_t cur, blocks_todo = blkcnt;
     struct mmc* mmc = find_mmc_device(dev_num);
 
+    mmc_req_drain(dev_num);
+
     if (blkcnt == 0 || !mmc || ((start + blkcnt) > mmc->lba) || mmc_set_blocklen(mmc, mmc->read_bl_len))
     {
         return 0;
@@ -1220,15 +1512,146 @@ ulong_t mmc_bread(int32_t dev_num, ulong_t start, uint32_t blkcnt, void* dst)
     return blkcnt;
 }
 
-int32_t mmc_register(int32_t dev_num, struct mmc* mmc)
+/*
+ * Queue a read, DMA moves the data while the caller does other work.
+ * Single blocks and unaligned buffers go by PIO and finish right here.
+ */
+int32_t mmc_bread_async(int32_t dev_num, struct mmc_req* req, ulong_t start, uint32_t blkcnt, void* dst)
 {
-	mmc_devices[dev_num] = mmc;
+    req->start  = start;
+    req->blkcnt = blkcnt;
+    req->dst    = dst;
+    req->flags  = MMC_DATA_READ;
+
+    return mmc_req_submit(dev_num, req);
+}
+
+int32_t mmc_bwrite_async(int32_t dev_num, struct mmc_req* req, ulong_t start, uint32_t blkcnt, const void* src)
+{
+    req->start  = start;
+    req->blkcnt = blkcnt;
+    req->src    = src;
+    req->flags  = MMC_DATA_WRITE;
+
+    return mmc_req_submit(dev_num, req);
+}
 
-	if (!mmc->b_max)
+/* Move the queue forward without blocking, E_BUSY while requests are pending */
+int32_t mmc_poll(int32_t dev_num)
+{
+    struct mmc* mmc = find_mmc_device(dev_num);
+    struct mmc_req* req;
+    int32_t err;
+
+    if (!mmc || !(req = mmc->req_head))
     {
-		mmc->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
+        return E_OK;
     }
 
+    err = mmc->poll_cmd(mmc, &mmc->req_cmd, &mmc->req_data);
+    if (err == E_BUSY)
+    {
+        return E_BUSY;
+    }
+
+    if (mmc_rw_finish(mmc, &mmc->req_data, err))
+    {
+        mmc_req_complete(mmc, E_FAULT);
+    }
+    else
+    {
+        req->done += mmc->req_data.blocks;
+        if (req->done == req->blkcnt)
+        {
+            mmc_req_complete(mmc, E_OK);
+        }
+    }
+
+    return mmc_req_issue(mmc);
+}
+
+int32_t mmc_wait(int32_t dev_num, struct mmc_req* req)
+{
+    while (req->status == E_BUSY)
+    {
+        (void)mmc_poll(dev_num);
+    }
+
+    return req->status;
+}
+
+int32_t mmc_cancel(int32_t dev_num, struct mmc_req* req)
+{
+    struct mmc* mmc = find_mmc_device(dev_num);
+    struct mmc_req* prev = NULL;
+    struct mmc_req* cur;
+    int32_t err;
+
+    if (!mmc || req->status != E_BUSY)
+    {
+        return req->status;
+    }
+
+    for (cur = mmc->req_head; cur && cur != req; cur = cur->next)
+    {
+        prev = cur;
+    }
+
+    if (!cur)
+    {
+        return req->status;
+    }
+
+    // Not started yet
+    if (prev)
+    {
+        prev->next = req->next;
+        if (mmc->req_tail == req)
+        {
+            mmc->req_tail = prev;
+        }
+        req->next = NULL;
+        req->status = E_AGAIN;
+        return E_AGAIN;
+    }
+
+    if (req->flags & MMC_DATA_WRITE)
+    {
+        return mmc_wait(dev_num, req);
+    }
+
+    err = mmc->poll_cmd(mmc, &mmc->req_cmd, &mmc->req_data);
+    if (err == E_BUSY)
+    {
+        if (!mmc->abort_cmd)
+        {
+            while ((err = mmc->poll_cmd(mmc, &mmc->req_cmd, &mmc->req_data)) == E_BUSY)
+                ;
+        }
+        else
+        {
+            err = mmc->abort_cmd(mmc, &mmc->req_cmd, &mmc->req_data);
+        }
+    }
+
+    // A stopped read leaves the card sending data, CMD12 brings it back
+    (void)mmc_rw_finish(mmc, &mmc->req_data, err);
+    if (err)
+    {
+        (void)mmc_send_status(mmc, MMC_STATE_TRAN, MMC_RECOVER_TIMEOUT_MS);
+    }
+
+    // The rest of the request is dropped, the queue moves on
+    mmc_req_complete(mmc, E_AGAIN);
+    (void)mmc_req_issue(mmc);
+
+    return E_AGAIN;
+}
+
+int32_t mmc_register(int32_t dev_num, struct mmc* mmc)
+{
+	mmc_devices[dev_num] = mmc;
+
 	return mmc_init(mmc);
 }
 
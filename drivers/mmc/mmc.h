@@ -51,6 +51,26 @@ struct mmc_data
     uint32_t blocksize;
 };
 
+/*
+ * Asynchronous block request. The driver owns it, and the buffer, from
+ * submit until status leaves E_BUSY. Only cache line aligned buffers are
+ * moved by DMA, others are copied through the FIFO by the CPU.
+ */
+struct mmc_req
+{
+    ulong_t  start;
+    uint32_t blkcnt;
+    union
+    {
+        void* dst;
+        const void* src;
+    };
+    uint32_t flags;         /* MMC_DATA_READ or MMC_DATA_WRITE */
+    uint32_t done;          /* Blocks transferred so far */
+    int32_t  status;        /* E_BUSY until completed, then E_OK, E_FAULT or E_AGAIN (cancelled) */
+    struct mmc_req* next;
+};
+
 struct mmc_config
 {
     const char* name;
@@ -58,7 +78,7 @@ struct mmc_config
     uint32_t voltages;
     uint32_t f_min;
     uint32_t f_max;
-    uint32_t b_max;
+    uint32_t max_req_size;  // bytes a single data command can move
     uint8_t  part_type;
 };
 
@@ -83,13 +103,22 @@ struct mmc
     uint32_t read_bl_len;
     uint32_t write_bl_len;
     uint32_t erase_grp_size;
+    uint8_t  erased_byte;   // What erased blocks read back as (0x00 or 0xFF)
     uint64_t capacity;
     int32_t (*send_cmd)(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data);
+    int32_t (*start_cmd)(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data);
+    int32_t (*poll_cmd)(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data);
+    int32_t (*abort_cmd)(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data);
     int32_t (*set_ios)(struct mmc* mmc);
     int32_t (*init)(struct mmc* mmc);
     uint32_t b_max;
     uint32_t lba;        // number of blocks
     uint32_t blksz;      // block size
+    // Asynchronous requests, the head one is in flight
+    struct mmc_req* req_head;
+    struct mmc_req* req_tail;
+    struct mmc_cmd  req_cmd;
+    struct mmc_data req_data;
 };
 
 /* Exported constants ------------------------------------- */
@@ -117,11 +146,18 @@ struct mmc
 #define MMC_MODE_8BIT       0x200
 #define MMC_MODE_SPI        0x400
 #define MMC_MODE_HC         0x800
+#define MMC_MODE_AUTO_STOP  0x1000  /* Host sends CMD12 at the end of open-ended transfers */
+#define MMC_MODE_CMD23      0x2000  /* SET_BLOCK_COUNT before multi-block transfers */
 
 #define SD_DATA_4BIT        0x00040000
+#define SD_CMD23_SUPPORT    0x00000002
+#define SD_DATA_STAT_AFTER_ERASE 0x00800000 /* Erased blocks read as 0xFF */
+
+#define EXT_CSD_ERASED_MEM_CONT  181    /* Bit 0 set: erased blocks read as 0xFF */
 
 #define MMC_DATA_READ       1
 #define MMC_DATA_WRITE      2
+#define MMC_DATA_PREDEFINED 4   /* Block count set by CMD23, no stop command */
 
 #define NO_CARD_ERR     -16 /* No SD/MMC card inserted */
 #define UNUSABLE_ERR    -17 /* Unusable Card */
@@ -143,6 +179,7 @@ struct mmc
 #define MMC_CMD_SET_BLOCKLEN            16
 #define MMC_CMD_READ_SINGLE_BLOCK       17
 #define MMC_CMD_READ_MULTIPLE_BLOCK     18
+#define MMC_CMD_SET_BLOCK_COUNT         23
 #define MMC_CMD_WRITE_SINGLE_BLOCK      24
 #define MMC_CMD_WRITE_MULTIPLE_BLOCK    25
 #define MMC_CMD_ERASE_GROUP_START       35
@@ -175,10 +212,17 @@ struct mmc
 #define OCR_ACCESS_MODE     0x60000000
 
 #define SECURE_ERASE        0x80000000
+#define MMC_ERASE_ARG       0x00000000
+
+/* CSD command classes, class 5 is erase */
+#define MMC_CSD_CCC_ERASE   (1 << 25)
 
 #define MMC_STATUS_MASK         (~0x0206BF7F)
 #define MMC_STATUS_RDY_FOR_DATA (1 << 8)
 #define MMC_STATUS_CURR_STATE   (0xf << 9)
+#define MMC_STATE_TRAN          (4 << 9)
+#define MMC_STATE_PRG           (7 << 9)
+#define MMC_STATE_ANY           (0xffffffff)    /* mmc_send_status: any state but PRG */
 #define MMC_STATUS_ERROR        (1 << 19)
 
 #define MMC_VDD_165_195     0x00000080  /* VDD voltage 1.65 - 1.95 */
@@ -271,12 +315,36 @@ int32_t mmc_unregister(int32_t dev_num);
 
 struct mmc* find_mmc_device(int32_t dev_num);
 
+/* Bring the card back to transfer state after a failed transfer (CMD13, CMD12 if needed) */
+int32_t mmc_recover(int32_t dev_num);
+
+/*
+ * The whole range reads back as mmc->erased_byte afterwards: whole erase
+ * groups are erased and the partial groups at either end (or every block
+ * on cards without erase support) are written with that value.
+ */
 int32_t mmc_berase(int32_t dev_num, ulong_t start, uint32_t blkcnt);
 
 ulong_t mmc_bwrite(int32_t dev_num, ulong_t start, uint32_t blkcnt, const void* src);
 
 ulong_t mmc_bread(int32_t dev_num, ulong_t start, uint32_t blkcnt, void* dst);
 
+int32_t mmc_bread_async(int32_t dev_num, struct mmc_req* req, ulong_t start, uint32_t blkcnt, void* dst);
+
+int32_t mmc_bwrite_async(int32_t dev_num, struct mmc_req* req, ulong_t start, uint32_t blkcnt, const void* src);
+
+int32_t mmc_poll(int32_t dev_num);
+
+int32_t mmc_wait(int32_t dev_num, struct mmc_req* req);
+
+/*
+ * Take a request back before it completes, the new status is returned.
+ * A queued request is just unlinked, a read in flight is stopped on the
+ * bus (hosts without abort_cmd finish the current chunk) and a write in
+ * flight is let finish. Blocks already moved to the buffer stay there.
+ */
+int32_t mmc_cancel(int32_t dev_num, struct mmc_req* req);
+
 #ifdef __cplusplus
     }
 #endif
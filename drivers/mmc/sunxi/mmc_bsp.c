@@ -16,6 +16,8 @@
 #include <delay.h>
 #include <string.h>
 #include <misc.h>
+#include <mmu.h>
+#include <crc32.h>
 
 
 /* Private types ------------------------------------------ */
@@ -26,16 +28,53 @@ struct sunxi_mmc_priv
     uint32_t* mclkreg;
     uint32_t  fatal_err;
     uint32_t  mod_clk;
+    uint32_t  req_clk;      // Bus clock asked for by the core
+    uint32_t  max_clk;      // Bus clock cap, set by tuning
+    int32_t   sclk_dly;     // Tuned sample delay, -1 uses the default table
+    // Command in flight, see mmc_start_cmd()
+    uint32_t  stage;
+    uint32_t  done_bit;
+    uint32_t  data_timeout;
+    int32_t   dma;
+    deadline_t deadline;
     struct sunxi_mmc* reg;
     struct mmc_config cfg;
 };
 
+/* IDMAC descriptor (chain mode) */
+struct sunxi_mmc_des
+{
+    uint32_t config;        /* DES0: Control and status */
+    uint32_t buf_size;      /* DES1: Buffer size */
+    uint32_t buf_addr;      /* DES2: Buffer address */
+    uint32_t next;          /* DES3: Next descriptor address */
+};
+
 /* Private constants -------------------------------------- */
 
 // GPIO Configurations
 #define SUNXI_GPC_SDC2          3
 #define SUNXI_GPF_SDC0          2
 
+// Pad drive strength levels, the default is the one the board boots with
+#define SUNXI_MMC_DRV_NUM       4
+#define SUNXI_MMC_DRV_DEFAULT   2
+
+// Bus tuning
+#define SUNXI_MMC_SAFE_CLK          (25000000)  /* Reference reads and recovery while tuning */
+#define SUNXI_MMC_TUNE_STEP         (5000000)
+#define SUNXI_MMC_TUNE_BLOCK        (16)        /* Boot image on sunxi SD layouts, so not blank */
+#define SUNXI_MMC_TUNE_BLOCKS       (SUNXI_MMC_TUNE_BUFFER_SIZE / 512)
+#define SUNXI_MMC_TUNE_READS        (2)         /* Reads per candidate setting */
+#define SUNXI_MMC_TUNE_VERIFY       (8)         /* Reads to confirm the chosen setting */
+#define SUNXI_MMC_TUNE_MIN_WINDOW   (3)
+#define SUNXI_MMC_SCLK_DLY_NUM      (8)
+
+// Stages of a command in flight
+#define SUNXI_MMC_STAGE_CMD     0   /* Waiting for the command to be sent */
+#define SUNXI_MMC_STAGE_DATA    1   /* Waiting for the data (and auto stop) */
+#define SUNXI_MMC_STAGE_BUSY    2   /* Waiting for the card to release DAT0 */
+
 // MMC Configurations
 #define SUNXI_MMC_STATUS_FIFO_EMPTY     (0x1 << 2)
 #define SUNXI_MMC_STATUS_FIFO_FULL      (0x1 << 3)
@@ -98,6 +137,7 @@ struct sunxi_mmc_priv
 #define SUNXI_MMC_CMD_WRITE                 (0x1 << 10)
 #define SUNXI_MMC_CMD_AUTO_STOP             (0x1 << 12)
 #define SUNXI_MMC_CMD_WAIT_PRE_OVER         (0x1 << 13)
+#define SUNXI_MMC_CMD_STOP_ABORT            (0x1 << 14)
 #define SUNXI_MMC_CMD_SEND_INIT_SEQ         (0x1 << 15)
 #define SUNXI_MMC_CMD_UPCLK_ONLY            (0x1 << 21)
 #define SUNXI_MMC_CMD_START                 (0x1 << 31)
@@ -110,6 +150,40 @@ struct sunxi_mmc_priv
 #define SUNXI_MMC_STATUS_CARD_DATA_BUSY     (0x1 << 9)
 #define SUNXI_MMC_STATUS_DATA_FSM_BUSY      (0x1 << 10)
 
+#define SUNXI_MMC_IDMAC_SOFT_RESET          (0x1 << 0)
+#define SUNXI_MMC_IDMAC_FIX_BURST           (0x1 << 1)
+#define SUNXI_MMC_IDMAC_IDMA_ON             (0x1 << 7)
+
+#define SUNXI_MMC_IDST_TX_INT               (0x1 << 0)
+#define SUNXI_MMC_IDST_RX_INT               (0x1 << 1)
+#define SUNXI_MMC_IDST_FATAL_BUS_ERR        (0x1 << 2)
+#define SUNXI_MMC_IDST_DES_UNAVAILABLE      (0x1 << 4)
+#define SUNXI_MMC_IDST_CARD_ERR_SUM         (0x1 << 5)
+#define SUNXI_MMC_IDST_ERROR                \
+    (SUNXI_MMC_IDST_FATAL_BUS_ERR |         \
+     SUNXI_MMC_IDST_DES_UNAVAILABLE |       \
+     SUNXI_MMC_IDST_CARD_ERR_SUM)
+#define SUNXI_MMC_IDST_ALL                  (0x337)
+
+#define SUNXI_MMC_IDMAC_DES0_DIC            (0x1 << 1)  /* Disable interrupt on completion */
+#define SUNXI_MMC_IDMAC_DES0_LD             (0x1 << 2)  /* Last descriptor */
+#define SUNXI_MMC_IDMAC_DES0_FD             (0x1 << 3)  /* First descriptor */
+#define SUNXI_MMC_IDMAC_DES0_CH             (0x1 << 4)  /* Chain mode */
+#define SUNXI_MMC_IDMAC_DES0_ER             (0x1 << 5)  /* End of ring */
+#define SUNXI_MMC_IDMAC_DES0_CES            (0x1 << 30) /* Card error summary */
+#define SUNXI_MMC_IDMAC_DES0_OWN            (0x1 << 31) /* Owned by the IDMAC */
+
+// FIFO watermarks used with the IDMAC: burst size 8, RX TL 7, TX TL 8
+#define SUNXI_MMC_FTRGLEVEL_DMA             (0x20070008)
+
+// DMA descriptor chain limits (each descriptor buffer size field is 16 bits)
+#define SUNXI_MMC_DMA_DES_NUM               (64)
+#define SUNXI_MMC_DMA_DES_BUFF_SIZE         (0x8000)
+#define SUNXI_MMC_DMA_MAX_BYTES             (SUNXI_MMC_DMA_DES_NUM * SUNXI_MMC_DMA_DES_BUFF_SIZE)
+
+// Cortex-A7 data cache line, DMA buffers must not share lines with other data
+#define SUNXI_MMC_DMA_ALIGN                 (64)
+
 /* Private macros ----------------------------------------- */
 
 
@@ -118,6 +192,9 @@ struct sunxi_mmc_priv
 static struct mmc mmc_dev[MAX_MMC_NUM];
 static struct sunxi_mmc_priv mmc_host[MAX_MMC_NUM];
 
+/* Only one transfer is in flight at a time so all hosts share the chain */
+static struct sunxi_mmc_des mmc_dma_des[SUNXI_MMC_DMA_DES_NUM] __attribute__ ((aligned (32)));
+
 /* Private function prototypes ---------------------------- */
 
 static int32_t mmc_resource_init(int32_t sdc_no)
@@ -146,7 +223,7 @@ static int32_t mmc_resource_init(int32_t sdc_no)
     return E_OK;
 }
 
-static void mmc_pinmux_setup(int32_t sdc)
+static void mmc_pinmux_setup(int32_t sdc, uint32_t drv)
 {
     uint32_t pin;
 
@@ -158,7 +235,7 @@ static void mmc_pinmux_setup(int32_t sdc)
         {
             GpioSetCfgpin(pin, SUNXI_GPF_SDC0);
             GpioSetPull(pin, GPIO_PULL_UP);
-            GpioSetDrv(pin, 2);
+            GpioSetDrv(pin, drv);
         }
         break;
     case 2:
@@ -167,14 +244,14 @@ static void mmc_pinmux_setup(int32_t sdc)
         {
             GpioSetCfgpin(pin, SUNXI_GPC_SDC2);
             GpioSetPull(pin, GPIO_PULL_UP);
-            GpioSetDrv(pin, 2);
+            GpioSetDrv(pin, drv);
         }
 
         for (pin = GPC(8); pin <= GPC(16); pin++)
         {
             GpioSetCfgpin(pin, SUNXI_GPC_SDC2);
             GpioSetPull(pin, GPIO_PULL_UP);
-            GpioSetDrv(pin, 2);
+            GpioSetDrv(pin, drv);
         }
         break;
     default:
@@ -236,6 +313,11 @@ static int mmc_set_mod_clk(int32_t sdc_no, uint32_t hz)
         sclk_dly = 4;
     }
 
+    if (priv->sclk_dly >= 0)
+    {
+        sclk_dly = priv->sclk_dly;
+    }
+
     uint32_t val = CCM_MMC_CTRL_OCLK_DLY(oclk_dly) | CCM_MMC_CTRL_SCLK_DLY(sclk_dly);
 
     writel(CCM_MMC_CTRL_ENABLE| pll | CCM_MMC_CTRL_N(n) | CCM_MMC_CTRL_M(div) | val, priv->mclkreg);
@@ -248,7 +330,7 @@ static int32_t mmc_clk_io_on(int32_t sdc_no)
     struct sunxi_mmc_priv* priv = &mmc_host[sdc_no];
 
     // Config gpio
-    mmc_pinmux_setup(sdc_no);
+    mmc_pinmux_setup(sdc_no, SUNXI_MMC_DRV_DEFAULT);
 
     // Config ahb clock
     // #define AHB_GATE_OFFSET_MMC0     8
@@ -269,14 +351,15 @@ static int32_t mmc_update_clk(struct mmc* mmc)
 {
     struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
     uint32_t cmd;
-    uint32_t timeout = 0xfffff;
+    deadline_t deadline;
 
     cmd = SUNXI_MMC_CMD_START | SUNXI_MMC_CMD_UPCLK_ONLY | SUNXI_MMC_CMD_WAIT_PRE_OVER;
     writel(cmd, &priv->reg->cmd);
 
+    deadline_set_ms(&deadline, 100);
     while(readl(&priv->reg->cmd) & SUNXI_MMC_CMD_START)
     {
-        if (--timeout == 0)
+        if (deadline_expired(&deadline))
         {
             return -1;
         }
@@ -293,6 +376,13 @@ static int32_t mmc_config_clock(struct mmc* mmc, uint32_t clk)
     struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
     uint32_t rval = readl(&priv->reg->clkcr);
 
+    // A tuned clock caps what the core asks for
+    priv->req_clk = clk;
+    if (clk > priv->max_clk)
+    {
+        clk = priv->max_clk;
+    }
+
     // Disable Clock
     rval &= ~SUNXI_MMC_CLK_ENABLE;
     writel(rval, &priv->reg->clkcr);
@@ -341,6 +431,124 @@ static int32_t mmc_set_ios(struct mmc* mmc)
     return E_OK;
 }
 
+static int32_t mmc_tune_apply(struct mmc* mmc, uint32_t hz, int32_t sclk_dly, uint32_t drv)
+{
+    struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
+    uint32_t req_clk = priv->req_clk;
+    int32_t  err;
+
+    mmc_pinmux_setup(priv->mmc_no, drv);
+    priv->sclk_dly = sclk_dly;
+    priv->max_clk = hz;
+
+    // The core's requested clock stays what it was
+    err = mmc_config_clock(mmc, hz);
+    priv->req_clk = req_clk;
+
+    return err;
+}
+
+static int32_t mmc_tune_check(struct mmc* mmc, uint8_t* buffer, uint32_t crc, uint32_t reads)
+{
+    struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
+
+    while (reads--)
+    {
+        if ((mmc_bread(priv->mmc_no, SUNXI_MMC_TUNE_BLOCK, SUNXI_MMC_TUNE_BLOCKS, buffer) != SUNXI_MMC_TUNE_BLOCKS) ||
+            (crc32(0, buffer, SUNXI_MMC_TUNE_BUFFER_SIZE) != crc))
+        {
+            return -1;
+        }
+    }
+
+    return E_OK;
+}
+
+/* Back to the clock and delays the card was brought up with */
+static int32_t mmc_tune_default(struct mmc* mmc)
+{
+    struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
+    int32_t err = mmc_tune_apply(mmc, priv->req_clk, -1, SUNXI_MMC_DRV_DEFAULT);
+
+    priv->max_clk = priv->cfg.f_max;
+
+    return err;
+}
+
+/*
+ * Read the reference blocks with a candidate setting. A failed candidate
+ * returns E_AGAIN with the card back in TRAN at the safe clock, E_ERROR
+ * when the card can't be brought back.
+ */
+static int32_t mmc_tune_try(struct mmc* mmc, uint32_t safe, uint32_t hz, int32_t sclk_dly, uint32_t drv,
+                            uint8_t* buffer, uint32_t crc, uint32_t reads)
+{
+    struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
+
+    if (!mmc_tune_apply(mmc, hz, sclk_dly, drv) && !mmc_tune_check(mmc, buffer, crc, reads))
+    {
+        return E_OK;
+    }
+
+    if (mmc_tune_apply(mmc, safe, -1, SUNXI_MMC_DRV_DEFAULT) || mmc_recover(priv->mmc_no))
+    {
+        return E_ERROR;
+    }
+
+    return E_AGAIN;
+}
+
+/*
+ * Sweep the sample delay at hz, the default drive strength first, and
+ * stop at the first window of passing delays wide enough (a single one
+ * at the safe clock). The middle of the window is applied and stored.
+ */
+static int32_t mmc_tune_search(struct mmc* mmc, uint32_t safe, uint32_t hz, uint8_t* buffer, uint32_t crc,
+                               struct sunxi_mmc_tuning* tuning)
+{
+    uint32_t need = ((hz <= safe) ? (1) : (SUNXI_MMC_TUNE_MIN_WINDOW));
+    uint32_t i, drv, run;
+    int32_t  dly, mid, ret;
+
+    for (i = 0; i < SUNXI_MMC_DRV_NUM; i++)
+    {
+        drv = (SUNXI_MMC_DRV_DEFAULT + i) % SUNXI_MMC_DRV_NUM;
+        run = 0;
+        for (dly = 0; dly < SUNXI_MMC_SCLK_DLY_NUM; dly++)
+        {
+            ret = mmc_tune_try(mmc, safe, hz, dly, drv, buffer, crc, SUNXI_MMC_TUNE_READS);
+            if (ret == E_ERROR)
+            {
+                return E_ERROR;
+            }
+            run = ((ret == E_OK) ? (run + 1) : (0));
+            if (run < need)
+            {
+                continue;
+            }
+
+            mid = dly - (int32_t)((need - 1) / 2);
+            ret = mmc_tune_try(mmc, safe, hz, mid, drv, buffer, crc, SUNXI_MMC_TUNE_VERIFY);
+            if (ret == E_OK)
+            {
+                memcpy(tuning->cid, mmc->cid, sizeof(tuning->cid));
+                tuning->clock    = hz;
+                tuning->sclk_dly = mid;
+                tuning->drv      = drv;
+                tuning->window   = need;
+                return E_OK;
+            }
+            if (ret == E_ERROR)
+            {
+                return E_ERROR;
+            }
+            run = 0;
+        }
+    }
+
+    return E_AGAIN;
+}
+
 static int32_t mmc_core_init(struct mmc* mmc)
 {
     struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
@@ -350,6 +558,9 @@ static int32_t mmc_core_init(struct mmc* mmc)
     
     delay_us(1000);
 
+    // FIFO watermarks for IDMAC bursts (ignored on PIO transfers)
+    writel(SUNXI_MMC_FTRGLEVEL_DMA, &priv->reg->ftrglevel);
+
     return E_OK;
 }
 
@@ -362,75 +573,194 @@ static int32_t mmc_trans_data_by_cpu(struct mmc *mmc, struct mmc_data* data)
     uint32_t  i;
     uint32_t  byte_cnt = data->blocksize * data->blocks;
     uint32_t* buff = (uint32_t*)(((reading) ? (data->dest) : (data->src)));
-    uint32_t  timeout = 2000;
+    uint8_t*  bytes = (uint8_t*)buff;
+    uint32_t  aligned = !((uint32_t)buff & 0x3);
+    uint32_t  word;
+    deadline_t deadline;
 
     // Always read / write data through the CPU
     set_wbit(&priv->reg->gctrl, SUNXI_MMC_GCTRL_ACCESS_BY_AHB);
 
+    deadline_set_ms(&deadline, 2000);
+
     for (i = 0; i < (byte_cnt >> 2); i++)
     {
         // Wait for Data on the FIFO / Wait for FIFO empty
         while(readl(&priv->reg->status) & status_bit)
         {
-            if(!timeout--)
+            if(deadline_expired(&deadline))
             {
                 return -1;
             }
-            delay_us(1000);
         }
 
         if(reading)
         {
-            buff[i] = readl(&priv->reg->fifo);
+            word = readl(&priv->reg->fifo);
+            if(aligned)
+            {
+                buff[i] = word;
+            }
+            else
+            {
+                // Unaligned buffers are only reached through PIO
+                bytes[(i << 2) + 0] = (uint8_t)(word >> 0);
+                bytes[(i << 2) + 1] = (uint8_t)(word >> 8);
+                bytes[(i << 2) + 2] = (uint8_t)(word >> 16);
+                bytes[(i << 2) + 3] = (uint8_t)(word >> 24);
+            }
         }
         else
         {
-            writel(buff[i], &priv->reg->fifo);
+            if(aligned)
+            {
+                word = buff[i];
+            }
+            else
+            {
+                word = ((uint32_t)bytes[(i << 2) + 0] << 0)  |
+                       ((uint32_t)bytes[(i << 2) + 1] << 8)  |
+                       ((uint32_t)bytes[(i << 2) + 2] << 16) |
+                       ((uint32_t)bytes[(i << 2) + 3] << 24);
+            }
+            writel(word, &priv->reg->fifo);
         }
     }
 
     return E_OK;
 }
 
-static int32_t mmc_rint_wait(struct mmc *mmc, uint32_t timeout_msecs, uint32_t done_bit, const char* what)
+static int32_t mmc_use_dma(struct mmc_data* data)
+{
+    uint32_t byte_cnt = data->blocksize * data->blocks;
+
+    // Single blocks and buffers not made of whole cache lines go through the FIFO by CPU,
+    // the cache maintenance around a DMA read would clobber data sharing its first or last line
+    return ((data->blocks > 1) &&
+            !((uint32_t)data->dest & (SUNXI_MMC_DMA_ALIGN - 1)) &&
+            !(byte_cnt & (SUNXI_MMC_DMA_ALIGN - 1)) &&
+            (byte_cnt <= SUNXI_MMC_DMA_MAX_BYTES));
+}
+
+static void mmc_trans_data_by_dma(struct mmc *mmc, struct mmc_data* data)
 {
     struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
-    uint32_t status;
+    struct sunxi_mmc_des* des = mmc_dma_des;
+    uint32_t remain = data->blocksize * data->blocks;
+    uint32_t buff = (uint32_t)data->dest;
+    uint32_t i, rval;
 
-    do
+    // Write back the data to send / drop stale lines of the data to receive
+    if (data->flags & MMC_DATA_WRITE)
     {
-        status = readl(&priv->reg->rint);
-        if (!timeout_msecs-- || (status & SUNXI_MMC_RINT_INTERRUPT_ERROR_BIT))
-        {   
-            return TIMEOUT;
-        }
-        delay_us(1000);
-    } while (!(status & done_bit));
+        dcache_clean_range(buff, remain);
+    }
+    else
+    {
+        dcache_clean_invalidate_range(buff, remain);
+    }
+
+    // Build descriptor chain (caller ensures it fits SUNXI_MMC_DMA_MAX_BYTES)
+    for (i = 0; remain > 0; i++)
+    {
+        uint32_t size = ((remain > SUNXI_MMC_DMA_DES_BUFF_SIZE) ? (SUNXI_MMC_DMA_DES_BUFF_SIZE) : (remain));
+
+        des[i].config = SUNXI_MMC_IDMAC_DES0_OWN | SUNXI_MMC_IDMAC_DES0_CH | SUNXI_MMC_IDMAC_DES0_DIC;
+        des[i].buf_size = size;
+        des[i].buf_addr = buff;
+        des[i].next = (uint32_t)&des[i + 1];
+
+        buff += size;
+        remain -= size;
+    }
+
+    des[0].config |= SUNXI_MMC_IDMAC_DES0_FD;
+    des[i - 1].config |= SUNXI_MMC_IDMAC_DES0_LD | SUNXI_MMC_IDMAC_DES0_ER;
+    des[i - 1].config &= ~SUNXI_MMC_IDMAC_DES0_DIC;
+    des[i - 1].next = 0;
+
+    // Descriptors must be in memory before the IDMAC fetches them
+    dcache_clean_range((uint32_t)des, i * sizeof(struct sunxi_mmc_des));
+
+    // Route the FIFO to the DMA interface
+    rval = readl(&priv->reg->gctrl);
+    rval |= SUNXI_MMC_GCTRL_DMA_ENABLE | SUNXI_MMC_GCTRL_DMA_RESET;
+    rval &= ~SUNXI_MMC_GCTRL_ACCESS_BY_AHB;
+    writel(rval, &priv->reg->gctrl);
+
+    // Reset IDMAC and point it to the chain
+    writel(SUNXI_MMC_IDMAC_SOFT_RESET, &priv->reg->dmac);
+    writel(SUNXI_MMC_IDST_ALL, &priv->reg->idst);
+    writel(0, &priv->reg->idie);
+    writel((uint32_t)des, &priv->reg->dlba);
 
-    return 0;
+    // Start IDMAC, the transfer begins once the command is issued
+    writel(SUNXI_MMC_IDMAC_FIX_BURST | SUNXI_MMC_IDMAC_IDMA_ON, &priv->reg->dmac);
 }
 
-static int32_t mmc_send_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data)
+static int32_t mmc_dma_stop(struct mmc *mmc, struct mmc_data* data)
 {
     struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
-    uint32_t cmdval = SUNXI_MMC_CMD_START;
-    int32_t  timeout = 0;
-    int32_t  error = 0;
-    uint32_t status = 0;
+    uint32_t status = readl(&priv->reg->idst);
+    uint32_t rval;
 
-    if (priv->fatal_err)
+    // Discard lines speculatively loaded while the IDMAC was writing
+    if (data->flags & MMC_DATA_READ)
     {
-        return -1;
+        dcache_invalidate_range((uint32_t)data->dest, data->blocksize * data->blocks);
     }
-    if (cmd->resp_type & MMC_RSP_BUSY)
+
+    writel(SUNXI_MMC_IDST_ALL, &priv->reg->idst);
+    writel(0, &priv->reg->dmac);
+
+    rval = readl(&priv->reg->gctrl);
+    writel(rval | SUNXI_MMC_GCTRL_DMA_RESET, &priv->reg->gctrl);
+    rval &= ~SUNXI_MMC_GCTRL_DMA_ENABLE;
+    writel(rval | SUNXI_MMC_GCTRL_FIFO_RESET, &priv->reg->gctrl);
+
+    return ((status & SUNXI_MMC_IDST_ERROR) ? (-1) : (E_OK));
+}
+
+static int32_t mmc_end_cmd(struct mmc* mmc, struct mmc_data* data, int32_t error)
+{
+    struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
+
+    if (priv->dma)
     {
+        (void)mmc_dma_stop(mmc, data);
+        priv->dma = 0;
+    }
 
+    if (error)
+    {
+        writel(SUNXI_MMC_GCTRL_RESET, &priv->reg->gctrl);
+        mmc_update_clk(mmc);
     }
-    if (cmd->cmdidx == 12)
+
+    writel(0xffffffff, &priv->reg->rint);
+    writel(readl(&priv->reg->gctrl) | SUNXI_MMC_GCTRL_FIFO_RESET, &priv->reg->gctrl);
+
+    return error;
+}
+
+/*
+ * Issue a command. DMA transfers keep running after it returns and
+ * are completed by mmc_poll_cmd(), PIO transfers are done here.
+ */
+static int32_t mmc_start_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data)
+{
+    struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
+    uint32_t cmdval = SUNXI_MMC_CMD_START;
+
+    if (priv->fatal_err)
     {
-        return E_OK;
+        return -1;
     }
 
+    // An explicit CMD12 aborts whatever the data state machine is doing
+    if (cmd->cmdidx == 12)
+        cmdval |= SUNXI_MMC_CMD_STOP_ABORT;
+
     if (!cmd->cmdidx)
         cmdval |= SUNXI_MMC_CMD_SEND_INIT_SEQ;
     if (cmd->resp_type & MMC_RSP_PRESENT)
@@ -440,76 +770,117 @@ static int32_t mmc_send_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_dat
     if (cmd->resp_type & MMC_RSP_CRC)
         cmdval |= SUNXI_MMC_CMD_CHK_RESPONSE_CRC;
 
+    priv->dma = 0;
+    priv->stage = SUNXI_MMC_STAGE_CMD;
+    deadline_set_ms(&priv->deadline, 1000);
+
     if (data)
     {
-        if ((uint32_t)data->dest & 0x3)
-        {
-            error = -1;
-            goto out;
-        }
-
         cmdval |= SUNXI_MMC_CMD_DATA_EXPIRE | SUNXI_MMC_CMD_WAIT_PRE_OVER;
         if (data->flags & MMC_DATA_WRITE)
             cmdval |= SUNXI_MMC_CMD_WRITE;
-        if (data->blocks > 1)
+        if ((data->blocks > 1) && !(data->flags & MMC_DATA_PREDEFINED))
             cmdval |= SUNXI_MMC_CMD_AUTO_STOP;
         writel(data->blocksize, &priv->reg->blksz);
         writel(data->blocks * data->blocksize, &priv->reg->bytecnt);
+
+        priv->done_bit = ((cmdval & SUNXI_MMC_CMD_AUTO_STOP) ? (SUNXI_MMC_RINT_AUTO_COMMAND_DONE) : (SUNXI_MMC_RINT_DATA_OVER));
+        priv->data_timeout = 120;
     }
 
     writel(cmd->cmdarg, &priv->reg->arg);
 
     if (!data)
+    {
         writel(cmdval | cmd->cmdidx, &priv->reg->cmd);
+        return E_OK;
+    }
 
     /*
      * transfer data and check status
      * STATREG[2] : FIFO empty
      * STATREG[3] : FIFO full
      */
-    if (data)
+    priv->dma = mmc_use_dma(data);
+    if (priv->dma)
     {
-        int32_t ret = 0;
+        // IDMAC must be armed before the command starts the transfer
+        mmc_trans_data_by_dma(mmc, data);
+        writel(cmdval | cmd->cmdidx, &priv->reg->cmd);
 
+        // The whole transfer happens after the command (budget 1KB/ms)
+        priv->data_timeout += ((data->blocksize * data->blocks) >> 10);
+    }
+    else
+    {
         writel(cmdval | cmd->cmdidx, &priv->reg->cmd);
-        ret = mmc_trans_data_by_cpu(mmc, data);
-        
-        if (ret)
+        if (mmc_trans_data_by_cpu(mmc, data))
         {
-            error = readl(&priv->reg->rint) & SUNXI_MMC_RINT_INTERRUPT_ERROR_BIT;
-            goto out;
+            return mmc_end_cmd(mmc, data, -1);
         }
     }
 
-    error = mmc_rint_wait(mmc, 1000, SUNXI_MMC_RINT_COMMAND_DONE, "cmd");
+    return E_OK;
+}
 
-    if (error)
-        goto out;
+/* Advance the command from mmc_start_cmd(), E_BUSY while it is still running */
+static int32_t mmc_poll_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data)
+{
+    struct sunxi_mmc_priv* priv = (struct sunxi_mmc_priv*)mmc->priv;
+    uint32_t status = readl(&priv->reg->rint);
 
-    if (data)
+    if (priv->stage != SUNXI_MMC_STAGE_BUSY)
     {
-        error = mmc_rint_wait(mmc, 120, data->blocks > 1 ?
-				      SUNXI_MMC_RINT_AUTO_COMMAND_DONE :
-				      SUNXI_MMC_RINT_DATA_OVER,
-				      "data");
-		if (error)
-			goto out;
-    }
+        if (status & SUNXI_MMC_RINT_INTERRUPT_ERROR_BIT)
+        {
+            return mmc_end_cmd(mmc, data, TIMEOUT);
+        }
 
-    if (cmd->resp_type & MMC_RSP_BUSY)
-    {
-        timeout = 2000;
-        do
+        if (priv->stage == SUNXI_MMC_STAGE_CMD)
         {
-            status = readl(&priv->reg->status);
-            if (!timeout--)
+            if (!(status & SUNXI_MMC_RINT_COMMAND_DONE))
             {
-                error = -1;
-                goto out;
+                return ((deadline_expired(&priv->deadline)) ? (mmc_end_cmd(mmc, data, TIMEOUT)) : (E_BUSY));
             }
-            delay_us(1000);
-        } while (status & SUNXI_MMC_STATUS_CARD_DATA_BUSY);
+
+            priv->stage = ((data) ? (SUNXI_MMC_STAGE_DATA) : (SUNXI_MMC_STAGE_BUSY));
+            if (data)
+            {
+                deadline_set_ms(&priv->deadline, priv->data_timeout);
+                return E_BUSY;
+            }
+        }
+        else
+        {
+            if (!(status & priv->done_bit))
+            {
+                return ((deadline_expired(&priv->deadline)) ? (mmc_end_cmd(mmc, data, TIMEOUT)) : (E_BUSY));
+            }
+
+            if (priv->dma)
+            {
+                priv->dma = 0;
+                if (mmc_dma_stop(mmc, data))
+                {
+                    return mmc_end_cmd(mmc, data, -1);
+                }
+            }
+
+            priv->stage = SUNXI_MMC_STAGE_BUSY;
+        }
+
+        deadline_set_ms(&priv->deadline, 2000);
+    }
+
+    // The card holds DAT0 low while it programs written blocks
+    if ((cmd->resp_type & MMC_RSP_BUSY) || (data && (data->flags & MMC_DATA_WRITE)))
+    {
+        if (readl(&priv->reg->status) & SUNXI_MMC_STATUS_CARD_DATA_BUSY)
+        {
+            return ((deadline_expired(&priv->deadline)) ? (mmc_end_cmd(mmc, data, -1)) : (E_BUSY));
+        }
     }
+
     if (cmd->resp_type & MMC_RSP_136)
     {
         cmd->response[0] = readl(&priv->reg->resp3);
@@ -522,15 +893,26 @@ static int32_t mmc_send_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_dat
         cmd->response[0] = readl(&priv->reg->resp0);
     }
 
-out:
+    return mmc_end_cmd(mmc, data, E_OK);
+}
+
+/* Stop the command from mmc_start_cmd() where it is, data not yet moved is lost */
+static int32_t mmc_abort_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data)
+{
+    return mmc_end_cmd(mmc, data, -1);
+}
+
+static int32_t mmc_send_cmd(struct mmc* mmc, struct mmc_cmd* cmd, struct mmc_data* data)
+{
+    int32_t error = mmc_start_cmd(mmc, cmd, data);
+
     if (error)
     {
-        writel(SUNXI_MMC_GCTRL_RESET, &priv->reg->gctrl);
-        mmc_update_clk(mmc);
+        return error;
     }
 
-    writel(0xffffffff, &priv->reg->rint);
-    writel(readl(&priv->reg->gctrl) | SUNXI_MMC_GCTRL_FIFO_RESET, &priv->reg->gctrl);
+    while ((error = mmc_poll_cmd(mmc, cmd, data)) == E_BUSY)
+        ;
 
     return error;
 }
@@ -548,16 +930,24 @@ int32_t sunxi_mmc_init(int32_t sdc_no)
 
     cfg->name = "SUNXI SD/MMC";
     mmc->priv = &mmc_host[sdc_no];
+    mmc_host[sdc_no].sclk_dly = -1;
     mmc->cfg = &mmc_host[sdc_no].cfg;
     mmc->send_cmd = mmc_send_cmd;
+    mmc->start_cmd = mmc_start_cmd;
+    mmc->poll_cmd = mmc_poll_cmd;
+    mmc->abort_cmd = mmc_abort_cmd;
     mmc->set_ios = mmc_set_ios;
     mmc->init = mmc_core_init;
 
     cfg->voltages = MMC_VDD_32_33 | MMC_VDD_33_34;
     cfg->host_caps = MMC_MODE_4BIT | MMC_MODE_HS_52MHz | MMC_MODE_HS;
-    cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
+    cfg->host_caps |= MMC_MODE_AUTO_STOP | MMC_MODE_CMD23;
+    // BYTCNT is 32 bits wide, one IDMAC descriptor chain is the tighter limit
+    cfg->max_req_size = SUNXI_MMC_DMA_MAX_BYTES;
 	cfg->f_min = 400000;
 	cfg->f_max = 52000000;
+    // Cards run at the clock the core asks for until a tuning takes over
+    mmc_host[sdc_no].max_clk = cfg->f_max;
 
     if (mmc_resource_init(sdc_no))
     {
@@ -571,3 +961,62 @@ int32_t sunxi_mmc_init(int32_t sdc_no)
 
     return mmc->lba;
 }
+
+int32_t sunxi_mmc_tune(int32_t sdc_no, struct sunxi_mmc_tuning* tuning, uint8_t* buffer)
+{
+    struct mmc* mmc = &mmc_dev[sdc_no];
+    struct sunxi_mmc_priv* priv = &mmc_host[sdc_no];
+    uint32_t target = priv->req_clk;
+    uint32_t safe = ((target < SUNXI_MMC_SAFE_CLK) ? (target) : (SUNXI_MMC_SAFE_CLK));
+    uint32_t hz, crc;
+    int32_t  ret;
+
+    if (!mmc->has_init || (tuning == NULL) || (buffer == NULL))
+    {
+        return -1;
+    }
+
+    // The clock can't change under a transfer still in flight
+    while (mmc_poll(sdc_no) == E_BUSY)
+        ;
+
+    // Reference data read at a clock every card takes
+    if (mmc_tune_apply(mmc, safe, -1, SUNXI_MMC_DRV_DEFAULT) ||
+        (mmc_bread(sdc_no, SUNXI_MMC_TUNE_BLOCK, SUNXI_MMC_TUNE_BLOCKS, buffer) != SUNXI_MMC_TUNE_BLOCKS))
+    {
+        (void)mmc_tune_default(mmc);
+        return -1;
+    }
+    crc = crc32(0, buffer, SUNXI_MMC_TUNE_BUFFER_SIZE);
+
+    // A previous result for this card only needs to be confirmed
+    if (!memcmp(tuning->cid, mmc->cid, sizeof(tuning->cid)) && (tuning->clock <= target) &&
+        (tuning->clock >= safe) && (tuning->sclk_dly < SUNXI_MMC_SCLK_DLY_NUM) && (tuning->drv < SUNXI_MMC_DRV_NUM))
+    {
+        ret = mmc_tune_try(mmc, safe, tuning->clock, tuning->sclk_dly, tuning->drv, buffer, crc, SUNXI_MMC_TUNE_VERIFY);
+        if (ret == E_OK)
+        {
+            return E_OK;
+        }
+        if (ret != E_AGAIN)
+        {
+            (void)mmc_tune_default(mmc);
+            return -1;
+        }
+    }
+
+    // From the requested clock down, the first clock with a window wins
+    hz = target;
+    while ((ret = mmc_tune_search(mmc, safe, hz, buffer, crc, tuning)) == E_AGAIN && (hz > safe))
+    {
+        hz = ((hz - SUNXI_MMC_TUNE_STEP > safe) ? (hz - SUNXI_MMC_TUNE_STEP) : (safe));
+    }
+
+    if (ret != E_OK)
+    {
+        (void)mmc_tune_default(mmc);
+        return -1;
+    }
+
+    return E_OK;
+}
@@ -56,6 +56,17 @@ struct sunxi_mmc
     uint32_t fifo;          /* (0x200) SMC FIFO Access Address */
 };
 
+/* Bus timing found by sunxi_mmc_tune(), only valid for the card with this cid */
+struct sunxi_mmc_tuning
+{
+    uint32_t cid[4];
+    uint32_t clock;         /* Bus clock in Hz */
+    uint8_t  sclk_dly;      /* Sample delay */
+    uint8_t  drv;           /* Pad drive strength */
+    uint8_t  window;        /* Passing sample delays around sclk_dly */
+    uint8_t  reserved;
+};
+
 /* Exported constants ------------------------------------- */
 
 #define MAX_MMC_NUM         3
@@ -64,6 +75,9 @@ struct sunxi_mmc
 #define SDMMC1_BASE         0x01C10000
 #define SDMMC2_BASE         0x01C11000
 
+/* Scratch buffer sunxi_mmc_tune() needs */
+#define SUNXI_MMC_TUNE_BUFFER_SIZE  (4096)
+
 /* Exported macros ---------------------------------------- */
 
 
@@ -71,6 +85,8 @@ struct sunxi_mmc
 
 int32_t sunxi_mmc_init(int32_t sdc_no);
 
+int32_t sunxi_mmc_tune(int32_t sdc_no, struct sunxi_mmc_tuning* tuning, uint8_t* buffer);
+
 #ifdef __cplusplus
     }
 #endif
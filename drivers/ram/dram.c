@@ -15,13 +15,13 @@
 #define SUNXI_DRAM_PHY0_BASE		0x01c65000
 #define SUNXI_DRAM_PHY1_BASE		0x01c66000
 
-static void mctl_phy_init(uint32_t val)
+static int mctl_phy_init(uint32_t val)
 {
 	struct sunxi_mctl_ctl_reg * const mctl_ctl =
 			(struct sunxi_mctl_ctl_reg *)SUNXI_DRAM_CTL0_BASE;
 
 	writel(val | PIR_INIT, &mctl_ctl->pir);
-	mctl_await_completion(&mctl_ctl->pgsr[0], PGSR_INIT_DONE, 0x1);
+	return mctl_await_completion(&mctl_ctl->pgsr[0], PGSR_INIT_DONE, 0x1);
 }
 
 static void mctl_set_bit_delays(struct dram_para *para)
@@ -153,7 +153,7 @@ static int mgray_to_bin(uint32_t val)
 	return lookup_table[val & 0x1f];
 }
 
-static void mctl_h3_zq_calibration_quirk(struct dram_para *para)
+static int mctl_h3_zq_calibration_quirk(struct dram_para *para)
 {
 	struct sunxi_mctl_ctl_reg * const mctl_ctl =
 			(struct sunxi_mctl_ctl_reg *)SUNXI_DRAM_CTL0_BASE;
@@ -168,7 +168,8 @@ static void mctl_h3_zq_calibration_quirk(struct dram_para *para)
 				CONFIG_DRAM_ZQ & 0xffff);
 
 		writel(PIR_CLRSR, &mctl_ctl->pir);
-		mctl_phy_init(PIR_ZCAL);
+		if (mctl_phy_init(PIR_ZCAL))
+			return 1;
 
 		reg_val = readl(&mctl_ctl->zqdr[0]);
 		reg_val &= (0x1f << 16) | (0x1f << 0);
@@ -195,13 +196,15 @@ static void mctl_h3_zq_calibration_quirk(struct dram_para *para)
 					&mctl_ctl->zqcr);
 
 			writel(PIR_CLRSR, &mctl_ctl->pir);
-			mctl_phy_init(PIR_ZCAL);
+			if (mctl_phy_init(PIR_ZCAL))
+				return 1;
 
 			zq_val[i] = readl(&mctl_ctl->zqdr[0]) & 0xff;
 			writel(REPEAT_BYTE(zq_val[i]), &mctl_ctl->zqdr[2]);
 
 			writel(PIR_CLRSR, &mctl_ctl->pir);
-			mctl_phy_init(PIR_ZCAL);
+			if (mctl_phy_init(PIR_ZCAL))
+				return 1;
 
 			val = readl(&mctl_ctl->zqdr[0]) >> 24;
 			zq_val[i] |= bin_to_mgray(mgray_to_bin(val) - 1) << 8;
@@ -213,6 +216,8 @@ static void mctl_h3_zq_calibration_quirk(struct dram_para *para)
 			writel((zq_val[5] << 16) | zq_val[4],
 			       &mctl_ctl->zqdr[2]);
 	}
+
+	return 0;
 }
 
 static void mctl_set_cr(struct dram_para *para)
@@ -229,7 +234,7 @@ static void mctl_set_cr(struct dram_para *para)
 	       MCTL_CR_ROW_BITS(para->row_bits), &mctl_com->cr);
 }
 
-static void mctl_sys_init(struct dram_para *para)
+static int mctl_sys_init(struct dram_para *para)
 {
 	struct sunxi_ccm_reg * const ccm =
 			(struct sunxi_ccm_reg *)SUNXI_CCM_BASE;
@@ -256,7 +261,8 @@ static void mctl_sys_init(struct dram_para *para)
 			CCM_DRAMCLK_CFG_SRC_PLL5 |
 			CCM_DRAMCLK_CFG_UPD);
 
-	mctl_await_completion(&ccm->dram_clk_cfg, CCM_DRAMCLK_CFG_UPD, 0);
+	if (mctl_await_completion(&ccm->dram_clk_cfg, CCM_DRAMCLK_CFG_UPD, 0))
+		return 1;
 
 	setbits(&ccm->ahb_reset0_cfg, 1 << AHB_RESET_OFFSET_MCTL);
 	setbits(&ccm->ahb_gate0, 1 << AHB_GATE_OFFSET_MCTL);
@@ -269,6 +275,7 @@ static void mctl_sys_init(struct dram_para *para)
 	writel(0xc00e, &mctl_ctl->clken);
 	delay_us(500);
 
+	return 0;
 }
 
 /* These are more guessed based on some Allwinner code. */
@@ -335,10 +342,12 @@ static int mctl_channel_init(struct dram_para *para)
 	mctl_set_bit_delays(para);
 	delay_us(50);
 
-	mctl_h3_zq_calibration_quirk(para);
+	if (mctl_h3_zq_calibration_quirk(para))
+		return 1;
 
-	mctl_phy_init(PIR_PLLINIT | PIR_DCAL | PIR_PHYRST |
-		      PIR_DRAMRST | PIR_DRAMINIT | PIR_QSGATE);
+	if (mctl_phy_init(PIR_PLLINIT | PIR_DCAL | PIR_PHYRST |
+			  PIR_DRAMRST | PIR_DRAMINIT | PIR_QSGATE))
+		return 1;
 
 	/* detect ranks and bus width */
 	if (readl(&mctl_ctl->pgsr[0]) & (0xfe << 20)) {
@@ -362,13 +371,15 @@ static int mctl_channel_init(struct dram_para *para)
 		delay_us(20);
 
 		/* re-train */
-		mctl_phy_init(PIR_QSGATE);
+		if (mctl_phy_init(PIR_QSGATE))
+			return 1;
 		if (readl(&mctl_ctl->pgsr[0]) & (0xfe << 20))
 			return 1;
 	}
 
 	/* check the dramc status */
-	mctl_await_completion(&mctl_ctl->statr, 0x1, 0x1);
+	if (mctl_await_completion(&mctl_ctl->statr, 0x1, 0x1))
+		return 1;
 
 	/* liuke added for refresh debug */
 	setbits(&mctl_ctl->rfshctl0, 0x1 << 31);
@@ -459,7 +470,8 @@ ulong_t DramInit(void)
 	};
 
 
-	mctl_sys_init(&para);
+	if (mctl_sys_init(&para))
+		return 0;
 
 	if (mctl_channel_init(&para))
 		return 0;
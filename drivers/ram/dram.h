@@ -9,6 +9,8 @@
 #define REPEAT_BYTE(x)	((~0ul / 0xff) * (x))
 #define CONFIG_DRAM_CLK 672
 
+#define DRAM_BASE		0x40000000
+
 struct sunxi_mctl_com_reg {
 	uint32_t cr;			/* 0x00 control register */
 	uint32_t cr_r1;		/* 0x04 rank 1 control register (R40 only) */
@@ -230,10 +232,11 @@ static inline int ns_to_t(int nanoseconds)
 
 void mctl_set_timing_params(struct dram_para *para);
 
-void mctl_await_completion(uint32_t *reg, uint32_t mask, uint32_t val);
+int32_t mctl_await_completion(uint32_t *reg, uint32_t mask, uint32_t val);
 
 bool_t mctl_mem_matches(uint32_t offset);
 
+/* Returns the DRAM size, 0 when a controller step did not complete */
 ulong_t DramInit(void);
 
 #endif /* _SUNXI_DRAM_SUN8I_H3_H */
@@ -1,15 +1,24 @@
 #include <misc.h>
 #include <dram.h>
-#include <misc.h>
+#include <delay.h>
 
 #define CONFIG_SYS_SDRAM_BASE		0x40000000
 
 /*
  * Wait up to 1s for value to be set in given part of reg.
+ * Returns E_BUSY when the controller did not get there.
  */
-void mctl_await_completion(uint32_t *reg, uint32_t mask, uint32_t val)
+int32_t mctl_await_completion(uint32_t *reg, uint32_t mask, uint32_t val)
 {
-	while ((readl(reg) & mask) != val) {}
+	deadline_t deadline;
+
+	deadline_set_ms(&deadline, 1000);
+	while ((readl(reg) & mask) != val) {
+		if (deadline_expired(&deadline))
+			return E_BUSY;
+	}
+
+	return E_OK;
 }
 
 /*
@@ -14,9 +14,20 @@
 #include <misc.h>
 #include <ccu.h>
 #include <serial.h>
+#include <gic.h>
+#include <string.h>
 
 /* Private types ------------------------------------------ */
 
+/* Single producer (IRQ handler) / single consumer ring, indexes run free */
+typedef struct
+{
+    uint8_t *buffer;
+    uint32_t mask;
+    volatile uint32_t head;         /* Written by the IRQ handler only */
+    volatile uint32_t tail;         /* Written by the reader only */
+    volatile uint32_t lineStatus;   /* Receive errors seen by the IRQ handler */
+}uart_ring_t;
 
 
 /* Private constants -------------------------------------- */
@@ -59,6 +70,13 @@
 
 #define FCR_EFIFO	0x01	/* Enable in and out hardware FIFOs */
 #define FCR_RRESET  0x02	/* Reset receiver FIFO */
+#define FCR_RT_HALF	0x80	/* RX interrupt trigger at FIFO half full */
+
+/* interrupt IDs in the iir */
+#define IIR_ID_MASK	0x0F
+#define IIR_BUSY	0x07	/* Busy detect, cleared reading the usr */
+
+#define UART_BAUD_TOLERANCE	(3)		/* Max baudrate error in percent */
 
 /* Private macros ----------------------------------------- */
 
@@ -66,6 +84,10 @@
 
 /* Private variables -------------------------------------- */
 
+static uint32_t UartBaudrate[4];
+
+static uart_ring_t UartRing[4];
+
 static h3_uart_t *h3Uarts[] =
 {
     (h3_uart_t *)SUNXI_UART0_BASE,
@@ -106,6 +128,77 @@ static inline void UartInitClock(uint32_t uartId)
 }
 
 
+static void UartIrqHandler(uint32_t irq)
+{
+    uint32_t uartId = irq - UART0_IRQ;
+    h3_uart_t *uart = h3Uarts[uartId];
+    uart_ring_t *ring = &UartRing[uartId];
+
+    if((uart->iir & IIR_ID_MASK) == IIR_BUSY)
+    {
+        (void)uart->usr;
+        return;
+    }
+
+    ring->lineStatus |= (uart->lsr & UART_LSR_ERRORS);
+
+    uint32_t head = ring->head;
+    uint32_t level = uart->rfl;
+    while(level--)
+    {
+        uint8_t c = (uint8_t)uart->data;
+
+        if((head - ring->tail) > ring->mask)
+        {
+            /* Ring full, report it as an overrun */
+            ring->lineStatus |= UART_LSR_OE;
+            continue;
+        }
+        ring->buffer[head & ring->mask] = c;
+        head++;
+    }
+
+    /* Data must be visible before the new head */
+    dmb();
+    ring->head = head;
+}
+
+static uint32_t UartRingRead(uint32_t uartId, uint8_t* dst, uint32_t size, uint32_t* lineStatus)
+{
+    uart_ring_t *ring = &UartRing[uartId];
+
+    if(ring->lineStatus != 0)
+    {
+        /* Keep the handler out while the errors are collected */
+        h3_uart_t *uart = h3Uarts[uartId];
+        uart->ier = 0;
+        *lineStatus |= ring->lineStatus;
+        ring->lineStatus = 0;
+        uart->ier = IE_RDA;
+    }
+
+    uint32_t tail = ring->tail;
+    uint32_t count = ring->head - tail;
+    dmb();
+
+    if(count > size)
+    {
+        count = size;
+    }
+
+    /* Copy up to the end of the ring and then from its start */
+    uint32_t offset = tail & ring->mask;
+    uint32_t first = min(count, (ring->mask + 1) - offset);
+    memcpy(dst, &ring->buffer[offset], first);
+    memcpy(&dst[first], ring->buffer, count - first);
+
+    dmb();
+    ring->tail = tail + count;
+
+    return count;
+}
+
+
 /* Private functions -------------------------------------- */
 
 /**
@@ -121,13 +214,10 @@ uint32_t UartInit(uint32_t uartId, uint32_t baudrate, uint32_t fifoConfig)
 
     /* Disable uart interrupts*/
     uart->ier = 0;
-    /* select dll dlh */
-    uart->lcr = LCR_DLAB;
-    /* set baudrate */
-    uart->ier = 0;			// DLH
-    uart->data = baudrate;	// LSB
     /* set line control */
     uart->lcr = fifoConfig;
+    /* set baudrate */
+    (void)UartSetBaudrate(uartId, baudrate);
     /* enable fifos */
     uart->iir = (FCR_EFIFO | FCR_RRESET);
     /* Interrupts configuration */
@@ -136,18 +226,190 @@ uint32_t UartInit(uint32_t uartId, uint32_t baudrate, uint32_t fifoConfig)
     return 0;
 }
 
+/**
+ * UartSetBaudrate Implementation (See header file for description)
+*/
+uint32_t UartSetBaudrate(uint32_t uartId, uint32_t baudrate)
+{
+    volatile h3_uart_t *uart = h3Uarts[uartId];
+    uint32_t clk = clock_get_apb2();
+
+    if(baudrate == 0)
+    {
+        return E_INVAL;
+    }
+
+    /* Round to the nearest divisor and check the resulting error */
+    uint32_t divisor = (clk + (8 * baudrate)) / (16 * baudrate);
+    if(divisor == 0 || divisor > 0xFFFF)
+    {
+        return E_INVAL;
+    }
+
+    uint32_t actual = clk / (16 * divisor);
+    uint32_t error = ((actual > baudrate) ? (actual - baudrate) : (baudrate - actual));
+    if((error * 100) > (baudrate * UART_BAUD_TOLERANCE))
+    {
+        return E_INVAL;
+    }
+
+    /* Do not cut a character being sent */
+    UartFlush(uartId);
+
+    /* The rx handler must not run while dll/dlh replace data/ier */
+    uint32_t ier = uart->ier;
+    uart->ier = 0;
+
+    uint32_t lcr = uart->lcr & ~LCR_DLAB;
+    /* select dll dlh */
+    uart->lcr = lcr | LCR_DLAB;
+    uart->ier = (divisor >> 8) & 0xFF;	// DLH
+    uart->data = divisor & 0xFF;		// DLL
+    /* restore line control */
+    uart->lcr = lcr;
+    uart->ier = ier;
+
+    UartBaudrate[uartId] = baudrate;
+
+    return E_OK;
+}
+
+/**
+ * UartGetBaudrate Implementation (See header file for description)
+*/
+uint32_t UartGetBaudrate(uint32_t uartId)
+{
+    return UartBaudrate[uartId];
+}
+
+/**
+ * UartFlush Implementation (See header file for description)
+*/
+void UartFlush(uint32_t uartId)
+{
+    h3_uart_t *uart = h3Uarts[uartId];
+
+    while (!(uart->lsr & TX_EMPTY)) {}
+}
+
 /**
  * UartGetc Implementation (See header file for description)
 */
 char UartGetc(uint32_t uartId)
 {
     h3_uart_t *uart = h3Uarts[uartId];
+    uart_ring_t *ring = &UartRing[uartId];
+
+    if(ring->buffer != NULL)
+    {
+        while(ring->head == ring->tail){}
+        dmb();
+
+        char c = (char)ring->buffer[ring->tail & ring->mask];
+        dmb();
+        ring->tail++;
+        return c;
+    }
 
     while(!(uart->lsr & RX_READY)){}
 
     return (char)uart->data;
 }
 
+/**
+ * UartEnableRxInterrupt Implementation (See header file for description)
+*/
+int32_t UartEnableRxInterrupt(uint32_t uartId, uint8_t* buffer, uint32_t size)
+{
+    h3_uart_t *uart = h3Uarts[uartId];
+    uart_ring_t *ring = &UartRing[uartId];
+
+    if(buffer == NULL || size == 0 || (size & (size - 1)) != 0)
+    {
+        return E_INVAL;
+    }
+
+    uart->ier = 0;
+
+    ring->buffer = buffer;
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->lineStatus = 0;
+
+    /* Interrupt at half FIFO, the timeout interrupt picks up the rest */
+    uart->iir = (FCR_EFIFO | FCR_RT_HALF);
+
+    if(GicEnableIrq(UART0_IRQ + uartId, UartIrqHandler) != E_OK)
+    {
+        ring->buffer = NULL;
+        return E_INVAL;
+    }
+
+    uart->ier = IE_RDA;
+
+    return E_OK;
+}
+
+/**
+ * UartDisableRxInterrupt Implementation (See header file for description)
+*/
+void UartDisableRxInterrupt(uint32_t uartId)
+{
+    h3_uart_t *uart = h3Uarts[uartId];
+
+    uart->ier = 0;
+    GicDisableIrq(UART0_IRQ + uartId);
+    UartRing[uartId].buffer = NULL;
+}
+
+/**
+ * UartRead Implementation (See header file for description)
+*/
+uint32_t UartRead(uint32_t uartId, uint8_t* dst, uint32_t size, uint32_t* lineStatus)
+{
+    h3_uart_t *uart = h3Uarts[uartId];
+    uint32_t count = 0;
+
+    if(UartRing[uartId].buffer != NULL)
+    {
+        return UartRingRead(uartId, dst, size, lineStatus);
+    }
+
+    /* Reading the lsr clears the error bits */
+    *lineStatus |= (uart->lsr & UART_LSR_ERRORS);
+
+    uint32_t level = uart->rfl;
+    if(level > size)
+    {
+        level = size;
+    }
+
+    /* Align the destination */
+    while(count < level && (((uint32_t)(dst + count)) & 0x3))
+    {
+        dst[count++] = (uint8_t)uart->data;
+    }
+
+    uint32_t *wdst = (uint32_t *)(dst + count);
+    while((level - count) >= 4)
+    {
+        uint32_t word = (uart->data & 0xFF);
+        word |= ((uart->data & 0xFF) << 8);
+        word |= ((uart->data & 0xFF) << 16);
+        word |= ((uart->data & 0xFF) << 24);
+        *wdst++ = word;
+        count += 4;
+    }
+
+    while(count < level)
+    {
+        dst[count++] = (uint8_t)uart->data;
+    }
+
+    return count;
+}
+
 /**
  * UartPutc Implementation (See header file for description)
 */
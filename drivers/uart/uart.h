@@ -29,6 +29,11 @@ typedef struct
 	volatile uint32_t mcr;	/* 10 - modem control */
 	volatile uint32_t lsr;	/* 14 - line status */
 	volatile uint32_t msr;	/* 18 - modem status */
+	volatile uint32_t sch;	/* 1c - scratch */
+	volatile uint32_t res0[23];	/* 20 - 78 reserved */
+	volatile uint32_t usr;	/* 7c - uart status */
+	volatile uint32_t tfl;	/* 80 - transmit FIFO level */
+	volatile uint32_t rfl;	/* 84 - receive FIFO level */
 }h3_uart_t;
 
 
@@ -40,8 +45,19 @@ typedef struct
 #define UART2	(2)
 #define UART3	(3)
 
+/* Line status receive errors, see UartRead */
+#define UART_LSR_OE		(0x02)	/* Overrun error */
+#define UART_LSR_PE		(0x04)	/* Parity error */
+#define UART_LSR_FE		(0x08)	/* Framing error */
+#define UART_LSR_BI		(0x10)	/* Break interrupt */
+#define UART_LSR_FIFOERR	(0x80)	/* Error in RX FIFO */
+#define UART_LSR_ERRORS		(UART_LSR_OE | UART_LSR_PE | UART_LSR_FE | UART_LSR_BI | UART_LSR_FIFOERR)
+
 /* User Macros */
-#define BAUD_115200    (0xD) /* 24 * 1000 * 1000 / 16 / 115200 = 13 */
+#define BAUD_115200    (115200)
+#define BAUD_460800    (460800)
+#define BAUD_921600    (921600)
+#define BAUD_1500000   (1500000)
 #define NO_PARITY      (0)
 #define ONE_STOP_BIT   (0)
 #define DAT_LEN_8_BITS (3)
@@ -62,6 +78,55 @@ typedef struct
 uint32_t UartInit(uint32_t uartId, uint32_t baudrate, uint32_t fifoConfig);
 
 
+/**
+ * @brief	Change the uart baudrate, the divisor is computed from the APB2 clock
+ * @param	uartId - ID uart
+ * 			baudrate - new baudrate
+ * @retval	E_OK or E_INVAL if the baudrate can not be generated within 3%
+ */
+uint32_t UartSetBaudrate(uint32_t uartId, uint32_t baudrate);
+
+/**
+ * @brief	Wait until all the data in the transmitter has been sent
+ * @param	uartId - ID uart
+ * @retval	No return value
+ */
+void UartFlush(uint32_t uartId);
+
+/**
+ * @brief	Get the current uart baudrate
+ * @param	uartId - ID uart
+ * @retval	Baudrate set by UartInit/UartSetBaudrate
+ */
+uint32_t UartGetBaudrate(uint32_t uartId);
+
+/**
+ * @brief	Receive through the RX interrupt into a ring buffer, UartRead and
+ * 			UartGetc then read from the ring
+ * @param	uartId - ID uart
+ * 			buffer - ring buffer
+ * 			size - ring size, power of two
+ * @retval	E_OK or E_INVAL
+ */
+int32_t UartEnableRxInterrupt(uint32_t uartId, uint8_t* buffer, uint32_t size);
+
+/**
+ * @brief	Go back to polled reception, data left in the ring is dropped
+ * @param	uartId - ID uart
+ * @retval	No return value
+ */
+void UartDisableRxInterrupt(uint32_t uartId);
+
+/**
+ * @brief	Read the received data without waiting (RX FIFO or ring buffer)
+ * @param	uartId - ID uart
+ * 			dst - destination buffer, word stores are used while it is aligned
+ * 			size - maximum number of bytes to read
+ * 			lineStatus - receive errors (UART_LSR_*) are or'ed into it
+ * @retval	Number of bytes read, 0 if nothing was received
+ */
+uint32_t UartRead(uint32_t uartId, uint8_t* dst, uint32_t size, uint32_t* lineStatus);
+
 /**
  * @brief    Get a character from the uart communication channel
  * @param    uart_id - ID uart
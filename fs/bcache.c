@@ -0,0 +1,637 @@
+/**
+ * @file        bcache.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Block Cache (LRU, write-back, sequential read ahead) between the file system and the MMC
+*/
+
+
+/* Includes ----------------------------------------------- */
+#include <bcache.h>
+#include <mmc.h>
+#include <string.h>
+
+
+/* Private types ------------------------------------------ */
+
+typedef struct
+{
+    ulong_t  sector;
+    uint32_t lru;
+    uint8_t  valid;
+    uint8_t  dirty;
+}bcache_entry_t;
+
+typedef struct
+{
+    ulong_t        start;
+    uint32_t       count;
+    uint32_t       used;        // Blocks handed to readers
+    uint8_t*       buff;
+    uint8_t        valid;
+    struct mmc_req req;
+}bcache_ra_t;
+
+/* A sequential reader, e.g. a file load or a FAT chain walk */
+typedef struct
+{
+    ulong_t        next;        // Where the stream continues
+    ulong_t        ahead;       // Where its next window starts
+    uint32_t       window;
+    uint32_t       strays;      // Reads of other streams since this one last moved
+    bcache_ra_t    ra[BCACHE_RA_SLOTS];
+}bcache_stream_t;
+
+
+/* Private constants -------------------------------------- */
+#define BCACHE_RA_MIN       16      /* First window of a new stream, doubles as windows get used */
+#define BCACHE_RA_STRAYS    4       /* Reads of other streams a stream survives, its window in flight too */
+
+
+/* Private macros ----------------------------------------- */
+#define BCACHE_DATA(e)      (&Bcache.data[((e) - Bcache.entries) * BCACHE_BLOCK_SIZE])
+
+
+/* Private variables -------------------------------------- */
+static struct
+{
+    int32_t         fd;
+    uint8_t*        data;
+    uint8_t*        staging;
+    uint32_t        tick;
+    bcache_stats_t  stats;
+    bcache_entry_t  entries[BCACHE_BLOCKS];
+    bcache_stream_t streams[BCACHE_RA_STREAMS];
+    ulong_t         raEnd;      // Read ahead stops here, see BcacheSetLimit
+}Bcache;
+
+
+/* Private function prototypes ---------------------------- */
+
+static bcache_entry_t* BcacheLookup(ulong_t sector)
+{
+    uint32_t i;
+    for(i = 0; i < BCACHE_BLOCKS; ++i)
+    {
+        if(Bcache.entries[i].valid && Bcache.entries[i].sector == sector)
+        {
+            return &Bcache.entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* A window still in flight is cancelled, the bus is not kept busy with blocks nobody reads */
+static void BcacheRaDrop(bcache_ra_t* ra)
+{
+    if(ra->valid)
+    {
+        if(mmc_cancel(Bcache.fd, &ra->req) == E_AGAIN)
+        {
+            Bcache.stats.raCancelled += ra->count;
+        }
+        else
+        {
+            Bcache.stats.raWasted += ((ra->used < ra->count) ? (ra->count - ra->used) : (0));
+        }
+        ra->valid = FALSE;
+    }
+}
+
+/* Forget the read ahead of a stream and treat its next read as the start of it */
+static void BcacheRaReset(bcache_stream_t* stream, ulong_t next)
+{
+    uint32_t i;
+    for(i = 0; i < BCACHE_RA_SLOTS; ++i)
+    {
+        BcacheRaDrop(&stream->ra[i]);
+    }
+
+    stream->next   = next;
+    stream->ahead  = next;
+    stream->window = BCACHE_RA_MIN;
+    stream->strays = 0;
+}
+
+static bool_t BcacheRaIdle(const bcache_stream_t* stream)
+{
+    uint32_t i;
+    for(i = 0; i < BCACHE_RA_SLOTS; ++i)
+    {
+        if(stream->ra[i].valid)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static bcache_ra_t* BcacheRaFind(bcache_stream_t* stream, ulong_t sector)
+{
+    uint32_t i;
+    for(i = 0; i < BCACHE_RA_SLOTS; ++i)
+    {
+        bcache_ra_t* ra = &stream->ra[i];
+        if(ra->valid && sector >= ra->start && sector < (ra->start + ra->count))
+        {
+            return ra;
+        }
+    }
+
+    return NULL;
+}
+
+static bcache_ra_t* BcacheRaLookup(bcache_stream_t* stream, ulong_t sector)
+{
+    bcache_ra_t* ra = BcacheRaFind(stream, sector);
+
+    // Still in flight, nothing else to do until it lands
+    if(ra != NULL && mmc_wait(Bcache.fd, &ra->req) != E_OK)
+    {
+        ra->valid = FALSE;
+        return NULL;
+    }
+
+    return ra;
+}
+
+/* The stream a read continues, the other streams count it as a stray */
+static bcache_stream_t* BcacheRaStream(ulong_t start)
+{
+    bcache_stream_t* match = NULL;
+    uint32_t i;
+
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        bcache_stream_t* stream = &Bcache.streams[i];
+        if(match == NULL && (start == stream->next || BcacheRaFind(stream, start) != NULL))
+        {
+            match = stream;
+        }
+        else
+        {
+            stream->strays += 1;
+        }
+    }
+
+    return match;
+}
+
+/* A read no stream expected may start one in place of an idle stream or one
+ * that other streams' reads have outlasted */
+static void BcacheRaStart(ulong_t next)
+{
+    bcache_stream_t* victim = NULL;
+    uint32_t i;
+
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        bcache_stream_t* stream = &Bcache.streams[i];
+        if(!BcacheRaIdle(stream) && stream->strays <= BCACHE_RA_STRAYS)
+        {
+            continue;
+        }
+        if(victim == NULL || stream->strays > victim->strays)
+        {
+            victim = stream;
+        }
+    }
+
+    if(victim != NULL)
+    {
+        BcacheRaReset(victim, next);
+    }
+}
+
+/* Synchronous transfers would wait for the window in flight. Unless it belongs
+ * to a stream that is still being read (all: FALSE) it is cancelled instead,
+ * and its stream reads it again if it ever gets there */
+static void BcacheRaCancel(bool_t all)
+{
+    uint32_t i, j;
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        bcache_stream_t* stream = &Bcache.streams[i];
+        if(!all && stream->strays <= BCACHE_RA_STRAYS)
+        {
+            continue;
+        }
+        for(j = 0; j < BCACHE_RA_SLOTS; ++j)
+        {
+            bcache_ra_t* ra = &stream->ra[j];
+            if(ra->valid && ra->req.status == E_BUSY)
+            {
+                BcacheRaDrop(ra);
+                // Windows are issued in order, the one in flight is the last of its stream
+                stream->ahead = ra->start;
+            }
+        }
+    }
+}
+
+/* Start reading the next window of the stream into a free slot, one window is
+ * in flight at a time so a reader never waits for more than that */
+static void BcacheRaFill(bcache_stream_t* stream)
+{
+    struct mmc* mmc = find_mmc_device(Bcache.fd);
+    ulong_t end = Bcache.raEnd;
+    uint32_t i, j;
+
+    if(mmc == NULL)
+    {
+        return;
+    }
+    if(end == 0 || end > mmc->lba)
+    {
+        end = mmc->lba;
+    }
+
+    for(i = 0; i < BCACHE_RA_SLOTS; ++i)
+    {
+        bcache_ra_t* ra = &stream->ra[i];
+
+        // Windows the reader has already passed are of no use
+        if(ra->valid && (ra->start + ra->count) <= stream->next)
+        {
+            BcacheRaDrop(ra);
+        }
+    }
+
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        for(j = 0; j < BCACHE_RA_SLOTS; ++j)
+        {
+            if(Bcache.streams[i].ra[j].valid && Bcache.streams[i].ra[j].req.status == E_BUSY)
+            {
+                return;
+            }
+        }
+    }
+
+    for(i = 0; i < BCACHE_RA_SLOTS && stream->ahead < end; ++i)
+    {
+        bcache_ra_t* ra = &stream->ra[i];
+        if(ra->valid)
+        {
+            continue;
+        }
+
+        ra->start = stream->ahead;
+        ra->count = (((end - ra->start) < stream->window) ? (end - ra->start) : (stream->window));
+        ra->used  = 0;
+        if(mmc_bread_async(Bcache.fd, &ra->req, ra->start, ra->count, ra->buff) != E_OK)
+        {
+            return;
+        }
+        ra->valid = TRUE;
+
+        stream->ahead += ra->count;
+        Bcache.stats.readaheads += ra->count;
+        break;
+    }
+}
+
+/* Device read that takes what it can from the read ahead and keeps a sequential stream going */
+static int32_t BcacheDevRead(ulong_t start, uint32_t blkcnt, uint8_t* out)
+{
+    bcache_stream_t* stream = BcacheRaStream(start);
+    bcache_ra_t* ra;
+    uint32_t done = 0;
+
+    while(stream != NULL && done < blkcnt && (ra = BcacheRaLookup(stream, start + done)) != NULL)
+    {
+        uint32_t offset = (start + done) - ra->start;
+        uint32_t n = ra->count - offset;
+        if(n > (blkcnt - done)) n = blkcnt - done;
+
+        memcpy(&out[done * BCACHE_BLOCK_SIZE], &ra->buff[offset * BCACHE_BLOCK_SIZE], n * BCACHE_BLOCK_SIZE);
+        ra->used += n;
+        done += n;
+        Bcache.stats.raHits += n;
+
+        // A window used to the end proves the stream, the next ones get bigger
+        if((offset + n) == ra->count)
+        {
+            BcacheRaDrop(ra);
+            if(stream->window < BCACHE_RA_BLOCKS)
+            {
+                stream->window <<= 1;
+            }
+        }
+    }
+
+    if(done < blkcnt)
+    {
+        // Interleaved streams wait for each other's windows, other reads don't
+        BcacheRaCancel(stream == NULL);
+        if(mmc_bread(Bcache.fd, start + done, blkcnt - done, &out[done * BCACHE_BLOCK_SIZE]) != (blkcnt - done))
+        {
+            return E_ERROR;
+        }
+    }
+
+    if(stream != NULL)
+    {
+        stream->next = start + blkcnt;
+        stream->strays = 0;
+        if(stream->ahead < stream->next)
+        {
+            stream->ahead = stream->next;
+        }
+        BcacheRaFill(stream);
+    }
+    else
+    {
+        BcacheRaStart(start + blkcnt);
+    }
+
+    return E_OK;
+}
+
+static int32_t BcacheDevWrite(ulong_t start, uint32_t blkcnt, const void* src)
+{
+    uint32_t i, j;
+
+    // Read ahead copies of these blocks are stale after the write
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        bcache_stream_t* stream = &Bcache.streams[i];
+        for(j = 0; j < BCACHE_RA_SLOTS; ++j)
+        {
+            bcache_ra_t* ra = &stream->ra[j];
+            if(ra->valid && start < (ra->start + ra->count) && ra->start < (start + blkcnt))
+            {
+                BcacheRaReset(stream, stream->next);
+                break;
+            }
+        }
+    }
+
+    BcacheRaCancel(TRUE);
+
+    return ((mmc_bwrite(Bcache.fd, start, blkcnt, src) == blkcnt) ? (E_OK) : (E_ERROR));
+}
+
+static int32_t BcacheWriteBack(bcache_entry_t* entry)
+{
+    if(entry->dirty)
+    {
+        if(BcacheDevWrite(entry->sector, 1, BCACHE_DATA(entry)) != E_OK)
+        {
+            return E_ERROR;
+        }
+        entry->dirty = FALSE;
+        Bcache.stats.writebacks += 1;
+    }
+
+    return E_OK;
+}
+
+static bcache_entry_t* BcacheAlloc(ulong_t sector)
+{
+    bcache_entry_t* victim = &Bcache.entries[0];
+
+    // Take a free entry or the least recently used one
+    uint32_t i;
+    for(i = 0; i < BCACHE_BLOCKS; ++i)
+    {
+        if(!Bcache.entries[i].valid)
+        {
+            victim = &Bcache.entries[i];
+            break;
+        }
+        if(Bcache.entries[i].lru < victim->lru)
+        {
+            victim = &Bcache.entries[i];
+        }
+    }
+
+    if(BcacheWriteBack(victim) != E_OK)
+    {
+        return NULL;
+    }
+
+    victim->sector = sector;
+    victim->valid  = TRUE;
+    victim->dirty  = FALSE;
+    victim->lru    = ++Bcache.tick;
+
+    return victim;
+}
+
+
+/* Private functions -------------------------------------- */
+
+int32_t BcacheInit(int32_t fd, uint8_t* buffer)
+{
+    if(buffer == NULL)
+    {
+        return E_INVAL;
+    }
+
+    memset(&Bcache, 0x0, sizeof(Bcache));
+
+    Bcache.fd   = fd;
+    Bcache.data = buffer;
+    Bcache.staging = buffer + (BCACHE_BLOCK_SIZE * BCACHE_BLOCKS);
+
+    uint32_t i, j;
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        for(j = 0; j < BCACHE_RA_SLOTS; ++j)
+        {
+            Bcache.streams[i].ra[j].buff = Bcache.staging + (BCACHE_BLOCK_SIZE * (BCACHE_FLUSH_BLOCKS + (((i * BCACHE_RA_SLOTS) + j) * BCACHE_RA_BLOCKS)));
+        }
+        Bcache.streams[i].window = BCACHE_RA_MIN;
+    }
+
+    return E_OK;
+}
+
+ulong_t BcacheRead(ulong_t start, uint32_t blkcnt, void* dst, uint32_t flags)
+{
+    uint8_t* out = (uint8_t*)dst;
+    uint32_t i, j;
+
+    if(flags & BCACHE_BYPASS)
+    {
+        // Bulk data goes straight to the caller, sequential readers still get read ahead
+        if(BcacheDevRead(start, blkcnt, out) != E_OK)
+        {
+            return 0;
+        }
+        Bcache.stats.bypassed += blkcnt;
+
+        // Cached copies are never older than the device so they win
+        for(i = 0; i < BCACHE_BLOCKS; ++i)
+        {
+            bcache_entry_t* entry = &Bcache.entries[i];
+            if(entry->valid && entry->dirty && entry->sector >= start && entry->sector < (start + blkcnt))
+            {
+                memcpy(&out[(entry->sector - start) * BCACHE_BLOCK_SIZE], BCACHE_DATA(entry), BCACHE_BLOCK_SIZE);
+            }
+        }
+
+        return blkcnt;
+    }
+
+    for(i = 0; i < blkcnt; i = j)
+    {
+        bcache_entry_t* entry = BcacheLookup(start + i);
+
+        if(entry != NULL)
+        {
+            memcpy(&out[i * BCACHE_BLOCK_SIZE], BCACHE_DATA(entry), BCACHE_BLOCK_SIZE);
+            entry->lru = ++Bcache.tick;
+            Bcache.stats.hits += 1;
+            j = i + 1;
+            continue;
+        }
+
+        // Read the whole run of missing blocks with a single request
+        for(j = i + 1; j < blkcnt && BcacheLookup(start + j) == NULL; ++j);
+
+        if(BcacheDevRead(start + i, j - i, &out[i * BCACHE_BLOCK_SIZE]) != E_OK)
+        {
+            return i;
+        }
+        Bcache.stats.misses += (j - i);
+
+        uint32_t k;
+        for(k = i; k < j; ++k)
+        {
+            entry = BcacheAlloc(start + k);
+            if(entry == NULL) return k;
+            memcpy(BCACHE_DATA(entry), &out[k * BCACHE_BLOCK_SIZE], BCACHE_BLOCK_SIZE);
+        }
+    }
+
+    return blkcnt;
+}
+
+ulong_t BcacheWrite(ulong_t start, uint32_t blkcnt, const void* src, uint32_t flags)
+{
+    const uint8_t* in = (const uint8_t*)src;
+    uint32_t i;
+
+    if(flags & BCACHE_BYPASS)
+    {
+        if(BcacheDevWrite(start, blkcnt, src) != E_OK)
+        {
+            return 0;
+        }
+        Bcache.stats.bypassed += blkcnt;
+
+        // Keep cached copies in sync with what is now on the device
+        for(i = 0; i < BCACHE_BLOCKS; ++i)
+        {
+            bcache_entry_t* entry = &Bcache.entries[i];
+            if(entry->valid && entry->sector >= start && entry->sector < (start + blkcnt))
+            {
+                memcpy(BCACHE_DATA(entry), &in[(entry->sector - start) * BCACHE_BLOCK_SIZE], BCACHE_BLOCK_SIZE);
+                entry->dirty = FALSE;
+            }
+        }
+
+        return blkcnt;
+    }
+
+    for(i = 0; i < blkcnt; ++i)
+    {
+        bcache_entry_t* entry = BcacheLookup(start + i);
+
+        if(entry == NULL)
+        {
+            entry = BcacheAlloc(start + i);
+            if(entry == NULL) return i;
+        }
+        else
+        {
+            entry->lru = ++Bcache.tick;
+        }
+
+        memcpy(BCACHE_DATA(entry), &in[i * BCACHE_BLOCK_SIZE], BCACHE_BLOCK_SIZE);
+        entry->dirty = TRUE;
+    }
+
+    return blkcnt;
+}
+
+int32_t BcacheFlush(void)
+{
+    while(1)
+    {
+        // Lowest dirty sector starts the next run
+        bcache_entry_t* first = NULL;
+        uint32_t i;
+        for(i = 0; i < BCACHE_BLOCKS; ++i)
+        {
+            bcache_entry_t* entry = &Bcache.entries[i];
+            if(entry->valid && entry->dirty && (first == NULL || entry->sector < first->sector))
+            {
+                first = entry;
+            }
+        }
+
+        if(first == NULL)
+        {
+            return E_OK;
+        }
+
+        // Merge the following dirty sectors so the run goes out in one command
+        ulong_t sector = first->sector;
+        bcache_entry_t* entry = first;
+        uint32_t count = 0;
+        do
+        {
+            memcpy(&Bcache.staging[count * BCACHE_BLOCK_SIZE], BCACHE_DATA(entry), BCACHE_BLOCK_SIZE);
+            count += 1;
+            entry = BcacheLookup(sector + count);
+        } while(count < BCACHE_FLUSH_BLOCKS && entry != NULL && entry->dirty);
+
+        if(BcacheDevWrite(sector, count, Bcache.staging) != E_OK)
+        {
+            return E_ERROR;
+        }
+        Bcache.stats.writebacks += count;
+
+        for(i = 0; i < count; ++i)
+        {
+            BcacheLookup(sector + i)->dirty = FALSE;
+        }
+    }
+}
+
+void BcacheInvalidate(void)
+{
+    (void)BcacheFlush();
+
+    uint32_t i;
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        BcacheRaReset(&Bcache.streams[i], Bcache.streams[i].next);
+    }
+
+    for(i = 0; i < BCACHE_BLOCKS; ++i)
+    {
+        Bcache.entries[i].valid = FALSE;
+    }
+}
+
+void BcacheSetLimit(ulong_t end)
+{
+    uint32_t i;
+    for(i = 0; i < BCACHE_RA_STREAMS; ++i)
+    {
+        BcacheRaReset(&Bcache.streams[i], Bcache.streams[i].next);
+    }
+    Bcache.raEnd = end;
+}
+
+void BcacheGetStats(bcache_stats_t* stats)
+{
+    memcpy(stats, &Bcache.stats, sizeof(bcache_stats_t));
+}
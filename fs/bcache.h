@@ -0,0 +1,73 @@
+/**
+ * @file        bcache.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Block Cache Header File
+*/
+
+#ifndef _BCACHE_H_
+#define _BCACHE_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported types ----------------------------------------- */
+
+typedef struct
+{
+    uint32_t hits;          /* Blocks served from the cache */
+    uint32_t misses;        /* Blocks read from the device */
+    uint32_t writebacks;    /* Dirty blocks written to the device */
+    uint32_t bypassed;      /* Blocks transferred with BCACHE_BYPASS */
+    uint32_t readaheads;    /* Blocks read ahead of a sequential stream */
+    uint32_t raHits;        /* Read ahead blocks handed to a reader */
+    uint32_t raWasted;      /* Read ahead blocks dropped unused */
+    uint32_t raCancelled;   /* Read ahead blocks cancelled before they landed */
+}bcache_stats_t;
+
+
+/* Exported constants ------------------------------------- */
+#define BCACHE_BLOCK_SIZE   512
+#define BCACHE_BLOCKS       128
+#define BCACHE_FLUSH_BLOCKS 32      /* Staging used to merge adjacent dirty blocks on flush */
+#define BCACHE_RA_STREAMS   2       /* Sequential readers followed at once, e.g. file data and the FAT */
+#define BCACHE_RA_SLOTS     2       /* Read ahead windows per stream, one is read while the other is in flight */
+#define BCACHE_RA_BLOCKS    512     /* Largest read ahead window */
+#define BCACHE_SIZE         (BCACHE_BLOCK_SIZE * (BCACHE_BLOCKS + BCACHE_FLUSH_BLOCKS + (BCACHE_RA_STREAMS * BCACHE_RA_SLOTS * BCACHE_RA_BLOCKS)))
+
+/* Access flags */
+#define BCACHE_BYPASS       (1 << 0)    /* Transfer straight to/from the device, not kept in the cache */
+
+
+/* Exported macros ---------------------------------------- */
+
+
+/* Exported functions ------------------------------------- */
+
+int32_t BcacheInit(int32_t fd, uint8_t* buffer);
+
+ulong_t BcacheRead(ulong_t start, uint32_t blkcnt, void* dst, uint32_t flags);
+
+ulong_t BcacheWrite(ulong_t start, uint32_t blkcnt, const void* src, uint32_t flags);
+
+int32_t BcacheFlush(void);
+
+void BcacheInvalidate(void);
+
+/* Read ahead never goes past end, e.g. the end of the partition (0: end of the device) */
+void BcacheSetLimit(ulong_t end);
+
+void BcacheGetStats(bcache_stats_t* stats);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _BCACHE_H_ */
@@ -9,19 +9,36 @@
 
 /* Includes ----------------------------------------------- */
 #include <fat32.h>
-#include <mmc.h>
+#include <bcache.h>
 #include <string.h>
 #include <delay.h>
 
 
 /* Private types ------------------------------------------ */
 
+typedef struct
+{
+    int32_t  base;      // First FAT sector held (-1 when empty)
+    uint32_t lru;
+    uint32_t dirty;
+    uint8_t* buff;
+}fat_window_t;
+
+typedef struct
+{
+    uint32_t    parent;     // First cluster of the directory holding the entry
+    uint32_t    hash;       // Case-folded name hash
+    uint32_t    lru;
+    uint32_t    len;        // Name length (0 when empty)
+    char        name[FAT32_DCACHE_NAME_MAX];
+    dir_entry_t entry;
+}fat_dentry_t;
 
 
 /* Private constants -------------------------------------- */
 #define ATTR_VFAT   (ATTR_RO | ATTR_HIDDEN | ATTR_SYS | ATTR_VOLUME)
 
-#define FATBUFFBLOCKS   4
+#define FATBUFFBLOCKS   FAT32_FAT_WINDOW_BLOCKS
 #define FATBUFFSIZE     (FatData.sectorSize * FATBUFFBLOCKS)
 
 #define DIRBUFFBLOCKS   (FatData.clusterSize)
@@ -29,6 +46,19 @@
 #define DIRMAXSIZE      (sizeof(dir_entry_t) * 0x10000)     // 2MB
 #define DIRMAXCLUSTERS  (DIRMAXSIZE / (FatData.clusterSize * FatData.sectorSize))
 
+#define FSINFO_LEAD_SIG     0x41615252
+#define FSINFO_STRUCT_SIG   0x61417272
+#define FSINFO_UNKNOWN      0xFFFFFFFF
+
+#define NOFREECLUSTER       0x0FFFFFF7
+
+#define DCACHEENTRIES       FAT32_DCACHE_ENTRIES
+#define DCACHENAMEMAX       FAT32_DCACHE_NAME_MAX
+#define DCACHESIZE          (DCACHEENTRIES * sizeof(fat_dentry_t))
+
+#define FREEMAPWORDS        ROUND_UP_DIV(FatData.clusterCount + 2, 32)
+#define FREEMAPCHUNKBLOCKS  128         // FAT sectors read per request while building the map
+
 
 /* Private macros ----------------------------------------- */
 #define ROUND_UP_DIV(dividend, divisor)     \
@@ -44,10 +74,12 @@ static struct
     int32_t  fd;
     // Fat Offset
     uint32_t fatOffset;
-    // FAT Buffer
-    uint8_t* fatBuff;
-    int32_t  fatBuffNum;
-    uint32_t fatDirty;
+    // FAT Windows
+    fat_window_t  fatWin[FAT32_FAT_WINDOWS];
+    fat_window_t* fatCur;
+    int32_t  fatLastBase;
+    uint32_t fatTick;
+    fat32_cache_stats_t fatStats;
     // Sector Info
     uint32_t totalSectors;
     uint16_t sectorSize;
@@ -64,6 +96,20 @@ static struct
     uint32_t rootDirSectors;
     // Data Area
     uint32_t dataStartSector;
+    uint32_t clusterCount;
+    // FSInfo
+    fs_info_t* info;
+    uint32_t infoSector;
+    uint32_t infoDirty;
+    // Directory entry cache
+    fat_dentry_t* dcache;
+    uint32_t dcacheTick;
+    // Free cluster bitmap (bit set means cluster in use)
+    uint32_t* freeMap;
+    uint32_t freeMapValid;
+    // Sector buffer for partial file reads, kept out of the metadata cache
+    uint8_t* fileBuff;
+    uint32_t fileSector;
 }FatData;
 
 static uint8_t* DirBuffer = NULL;
@@ -71,17 +117,45 @@ static uint8_t* DirBuffer = NULL;
 
 /* Private function prototypes ---------------------------- */
 
-int32_t Fat32FlushFat(void)
+int32_t Fat32FlushInfo(void)
+{
+    if(FatData.infoDirty && FatData.infoSector != 0)
+    {
+        BcacheWrite(FatData.infoSector, 1, FatData.info, 0);
+        FatData.infoDirty = FALSE;
+    }
+
+    return E_OK;
+}
+
+int32_t Fat32FlushWindow(fat_window_t* win)
 {
-    if(FatData.fatDirty)
+    if(win->dirty)
     {
-        mmc_bwrite(FatData.fd, (FatData.fatOffset + FatData.fatStartSector + FatData.fatBuffNum), FATBUFFBLOCKS, FatData.fatBuff);
-        FatData.fatDirty = FALSE;
+        uint32_t blocks = (((FatData.fatLength - win->base) < FATBUFFBLOCKS) ? (FatData.fatLength - win->base) : (FATBUFFBLOCKS));
+
+        if(BcacheWrite((FatData.fatOffset + FatData.fatStartSector + win->base), blocks, win->buff, BCACHE_BYPASS) != blocks)
+        {
+            return E_ERROR;
+        }
+        win->dirty = FALSE;
+        FatData.fatStats.writebacks += 1;
     }
 
     return E_OK;
 }
 
+int32_t Fat32FlushFat(void)
+{
+    uint32_t i;
+    for(i = 0; i < FAT32_FAT_WINDOWS; ++i)
+    {
+        (void)Fat32FlushWindow(&FatData.fatWin[i]);
+    }
+
+    return Fat32FlushInfo();
+}
+
 int32_t Fat32FlushDir(dir_t* dir)
 {
     if(dir->dirty == FALSE)
@@ -89,39 +163,111 @@ int32_t Fat32FlushDir(dir_t* dir)
         return E_OK;
     }
 
-    mmc_bwrite(FatData.fd, dir->sector, DIRBUFFBLOCKS, dir->buff);
+    BcacheWrite(dir->sector, DIRBUFFBLOCKS, dir->buff, 0);
 
     dir->dirty = FALSE;
 
     return E_OK;
 }
 
+fat_window_t* Fat32LoadWindow(int32_t base)
+{
+    fat_window_t* victim = &FatData.fatWin[0];
+
+    // Take an empty window or the least recently used one
+    uint32_t i;
+    for(i = 0; i < FAT32_FAT_WINDOWS; ++i)
+    {
+        if(FatData.fatWin[i].base < 0)
+        {
+            victim = &FatData.fatWin[i];
+            break;
+        }
+        if(FatData.fatWin[i].lru < victim->lru)
+        {
+            victim = &FatData.fatWin[i];
+        }
+    }
+
+    if(Fat32FlushWindow(victim) != E_OK)
+    {
+        return NULL;
+    }
+
+    // FAT windows bypass the block cache, they are a cache on their own
+    uint32_t blocks = (((FatData.fatLength - base) < FATBUFFBLOCKS) ? (FatData.fatLength - base) : (FATBUFFBLOCKS));
+    victim->base = -1;
+    if(BcacheRead(FatData.fatOffset + FatData.fatStartSector + base, blocks, victim->buff, BCACHE_BYPASS) != blocks)
+    {
+        return NULL;
+    }
+
+    victim->base = base;
+    victim->lru = ++FatData.fatTick;
+
+    return victim;
+}
+
+fat_window_t* Fat32FindWindow(int32_t base)
+{
+    uint32_t i;
+    for(i = 0; i < FAT32_FAT_WINDOWS; ++i)
+    {
+        if(FatData.fatWin[i].base == base)
+        {
+            return &FatData.fatWin[i];
+        }
+    }
+
+    return NULL;
+}
+
 uint32_t* Fat32ReadFatSector(uint32_t fatSector)
 {
-    if(fatSector > FatData.fatSectors)
+    if(fatSector >= FatData.fatLength)
     {
         return NULL;
     }
 
-    if((FatData.fatBuffNum < 0) || (fatSector >= (FatData.fatBuffNum + FATBUFFBLOCKS)) || ((int32_t)fatSector < FatData.fatBuffNum))
+    int32_t base = fatSector - (fatSector % FATBUFFBLOCKS);
+
+    fat_window_t* win = FatData.fatCur;
+
+    if(win == NULL || win->base != base)
     {
-        // Do we need to save the FAT buffer
-        Fat32FlushFat();
+        win = Fat32FindWindow(base);
+
+        if(win != NULL)
+        {
+            FatData.fatStats.hits += 1;
+        }
+        else
+        {
+            FatData.fatStats.misses += 1;
+            win = Fat32LoadWindow(base);
+            if(win == NULL) return NULL;
+        }
 
-        // Load new sectors to the FAT buffer
-        uint32_t loadbase = ((fatSector > FatData.fatSectors - FATBUFFBLOCKS) ? (FatData.fatSectors - FATBUFFBLOCKS) : (fatSector));
-        uint32_t offset = (FatData.fatOffset + FatData.fatStartSector + loadbase);
+        win->lru = ++FatData.fatTick;
 
-        if(mmc_bread(FatData.fd, offset, FATBUFFBLOCKS, FatData.fatBuff) == 0)
+        // Sequential chain walk, bring in the next window before it is needed
+        int32_t next = base + FATBUFFBLOCKS;
+        if(base == (FatData.fatLastBase + FATBUFFBLOCKS) && next < (int32_t)FatData.fatLength && Fat32FindWindow(next) == NULL)
         {
-            return NULL;
+            if(Fat32LoadWindow(next) != NULL)
+            {
+                FatData.fatStats.readaheads += 1;
+            }
+            // Keep the requested window as the most recent one
+            win->lru = ++FatData.fatTick;
         }
 
-        FatData.fatBuffNum = loadbase;
+        FatData.fatLastBase = base;
+        FatData.fatCur = win;
     }
 
     // Return requested sector
-    return (uint32_t*)(FatData.fatBuff + (FatData.sectorSize * (fatSector - FatData.fatBuffNum)));
+    return (uint32_t*)(win->buff + (FatData.sectorSize * (fatSector - base)));
 }
 
 void Fat32GetFatEntry(uint32_t cluster, uint32_t* fatSector, uint32_t* fatEntryOffset)
@@ -153,7 +299,7 @@ int32_t Fat32WriteEntry(uint32_t cluster, uint32_t newEntryVal)
     tmp = (tmp & 0xF0000000) | (newEntryVal & 0x0FFFFFFF);
     buffer[fatEntryOffset / 4] = tmp;
 
-    FatData.fatDirty = TRUE;
+    FatData.fatCur->dirty = TRUE;
 
     return E_OK;
 }
@@ -168,39 +314,288 @@ uint32_t Fat32GetNextCluster(uint32_t cluster)
    return Fat32ReadEntry(cluster);
 }
 
-uint32_t Fat32AllocateCluster(void)
+int32_t Fat32BuildFreeMap(void)
 {
-    uint32_t sectourCount = FatData.fatSectors;
+    uint32_t* chunk = &FatData.freeMap[FREEMAPWORDS];
+    uint32_t freeCount = 0;
+    uint32_t cluster = 0;
     uint32_t sector;
 
-    if(FatData.fatBuffNum == -1)
+    if(FatData.freeMap == NULL)
     {
-        // In this case we could read the Fs_Info for a hint
-        Fat32ReadFatSector(0);
+        return E_NO_MEMORY;
     }
 
-    for(sector = FatData.fatBuffNum; sectourCount > 0; sectourCount-=FATBUFFBLOCKS)
+    // Pending FAT window changes have to be visible to the bypass reads
+    Fat32FlushFat();
+
+    memset(FatData.freeMap, 0x0, FREEMAPWORDS * sizeof(uint32_t));
+
+    for(sector = 0; sector < FatData.fatLength && cluster < (FatData.clusterCount + 2); sector += FREEMAPCHUNKBLOCKS)
     {
-        uint32_t* buffer = (uint32_t*)FatData.fatBuff;
+        uint32_t blocks = (((FatData.fatLength - sector) < FREEMAPCHUNKBLOCKS) ? (FatData.fatLength - sector) : (FREEMAPCHUNKBLOCKS));
+
+        if(BcacheRead(FatData.fatOffset + FatData.fatStartSector + sector, blocks, chunk, BCACHE_BYPASS) != blocks)
+        {
+            return E_ERROR;
+        }
+
         uint32_t i;
-        for(i=0; i < (FATBUFFSIZE / 4); ++i)
+        for(i = 0; i < ((blocks * FatData.sectorSize) / 4) && cluster < (FatData.clusterCount + 2); ++i, ++cluster)
         {
-            if(buffer[i] == 0)
+            if((chunk[i] & 0x0FFFFFFF) != 0)
+            {
+                FatData.freeMap[cluster / 32] |= (1 << (cluster % 32));
+            }
+            else
             {
-                // Reserve cluster
-                buffer[i] = 1;
-                FatData.fatDirty = TRUE;
-                return i + (sector * (FatData.sectorSize / 4));
+                freeCount += 1;
             }
         }
+    }
 
-        // Not free cluster found load more sectors
-        sector += FATBUFFBLOCKS;
-        if(sector >= FatData.fatSectors) sector = 0;
-        Fat32ReadFatSector(sector);
+    // Anything past the last cluster can never be allocated
+    for(; cluster < (FREEMAPWORDS * 32); ++cluster)
+    {
+        FatData.freeMap[cluster / 32] |= (1 << (cluster % 32));
     }
 
-    return 0x0FFFFFF7;
+    // The scan gives the exact free count, refresh FSInfo with it
+    if(FatData.info->free_count != freeCount)
+    {
+        FatData.info->free_count = freeCount;
+        FatData.infoDirty = TRUE;
+    }
+
+    FatData.freeMapValid = TRUE;
+
+    return E_OK;
+}
+
+uint32_t Fat32FindFreeCluster(uint32_t hint)
+{
+    uint32_t n;
+
+    if(FatData.freeMapValid)
+    {
+        const uint32_t words = FREEMAPWORDS;
+        uint32_t word = hint / 32;
+
+        for(n = 0; n < words; ++n, ++word)
+        {
+            if(word >= words) word = 0;
+
+            // Skip fully used words
+            uint32_t bits = ~FatData.freeMap[word];
+            if(bits == 0) continue;
+
+            uint32_t bit;
+            for(bit = 0; (bits & (1 << bit)) == 0; ++bit);
+
+            return (word * 32) + bit;
+        }
+
+        return NOFREECLUSTER;
+    }
+
+    // No bitmap, walk the FAT starting at the hint
+    for(n = 0; n < FatData.clusterCount; ++n, ++hint)
+    {
+        if(hint >= (FatData.clusterCount + 2)) hint = 2;
+
+        if(Fat32ReadEntry(hint) == 0)
+        {
+            return hint;
+        }
+    }
+
+    return NOFREECLUSTER;
+}
+
+uint32_t Fat32AllocateCluster(void)
+{
+    if(FatData.freeMapValid == FALSE && FatData.freeMap != NULL)
+    {
+        // Built once on the first allocation so read only boots do not pay for it
+        (void)Fat32BuildFreeMap();
+    }
+
+    uint32_t cluster = Fat32FindFreeCluster(FatData.info->next_free);
+
+    if(cluster == NOFREECLUSTER)
+    {
+        return NOFREECLUSTER;
+    }
+
+    // Reserve cluster
+    Fat32WriteEntry(cluster, EOC);
+    if(FatData.freeMapValid)
+    {
+        FatData.freeMap[cluster / 32] |= (1 << (cluster % 32));
+    }
+
+    // Update FSInfo
+    if(FatData.info->free_count != FSINFO_UNKNOWN && FatData.info->free_count > 0)
+    {
+        FatData.info->free_count -= 1;
+    }
+    FatData.info->next_free = (((cluster + 1) < (FatData.clusterCount + 2)) ? (cluster + 1) : (2));
+    FatData.infoDirty = TRUE;
+
+    return cluster;
+}
+
+uint32_t Fat32IsClusterFree(uint32_t cluster)
+{
+    if(cluster < 2 || cluster >= (FatData.clusterCount + 2))
+    {
+        return FALSE;
+    }
+
+    if(FatData.freeMapValid)
+    {
+        return ((FatData.freeMap[cluster / 32] & (1 << (cluster % 32))) == 0);
+    }
+
+    return (Fat32ReadEntry(cluster) == 0);
+}
+
+uint32_t Fat32FindFreeRun(uint32_t clusters, uint32_t* length)
+{
+    const uint32_t end = FatData.clusterCount + 2;
+    uint32_t cluster = FatData.info->next_free;
+    uint32_t bestStart = NOFREECLUSTER;
+    uint32_t bestLength = 0;
+    uint32_t runStart = 0;
+    uint32_t runLength = 0;
+    uint32_t n;
+
+    if(cluster < 2 || cluster >= end) cluster = 2;
+
+    // Start at the beginning of the free run holding the hint so it is not split in two
+    while(cluster > 2 && (FatData.freeMap[(cluster - 1) / 32] & (1 << ((cluster - 1) % 32))) == 0)
+    {
+        cluster -= 1;
+    }
+
+    // First run of the requested length starting at the hint, otherwise the largest one
+    for(n = 0; n < FatData.clusterCount; ++n, ++cluster)
+    {
+        if(cluster >= end)
+        {
+            // Runs do not wrap around the end of the FAT
+            cluster = 2;
+            runLength = 0;
+        }
+
+        uint32_t word = FatData.freeMap[cluster / 32];
+
+        // Skip fully used words
+        if((cluster % 32) == 0 && word == 0xFFFFFFFF && (cluster + 32) <= end)
+        {
+            n += 31;
+            cluster += 31;
+            runLength = 0;
+            continue;
+        }
+
+        if(word & (1 << (cluster % 32)))
+        {
+            runLength = 0;
+            continue;
+        }
+
+        if(runLength == 0) runStart = cluster;
+        runLength += 1;
+
+        if(runLength > bestLength)
+        {
+            bestStart = runStart;
+            bestLength = runLength;
+
+            if(bestLength >= clusters) break;
+        }
+    }
+
+    *length = bestLength;
+
+    return bestStart;
+}
+
+uint32_t Fat32AllocateRun(uint32_t clusters, uint32_t* count)
+{
+    uint32_t first;
+    uint32_t n;
+
+    *count = 0;
+
+    if(FatData.freeMapValid == FALSE && FatData.freeMap != NULL)
+    {
+        (void)Fat32BuildFreeMap();
+    }
+
+    if(FatData.freeMapValid)
+    {
+        first = Fat32FindFreeRun(clusters, &n);
+        if(n > clusters) n = clusters;
+    }
+    else
+    {
+        // No bitmap, grow the run while the clusters following the first free one are free
+        first = Fat32FindFreeCluster(FatData.info->next_free);
+        for(n = 1; first != NOFREECLUSTER && n < clusters && Fat32IsClusterFree(first + n); ++n);
+    }
+
+    if(first == NOFREECLUSTER)
+    {
+        return NOFREECLUSTER;
+    }
+
+    // Reserve and chain the run
+    uint32_t i;
+    for(i = 0; i < n; ++i)
+    {
+        Fat32WriteEntry(first + i, (((i + 1) < n) ? (first + i + 1) : (EOC)));
+        if(FatData.freeMapValid)
+        {
+            FatData.freeMap[(first + i) / 32] |= (1 << ((first + i) % 32));
+        }
+    }
+
+    // Update FSInfo
+    if(FatData.info->free_count != FSINFO_UNKNOWN)
+    {
+        FatData.info->free_count = ((FatData.info->free_count > n) ? (FatData.info->free_count - n) : (0));
+    }
+    FatData.info->next_free = (((first + n) < (FatData.clusterCount + 2)) ? (first + n) : (2));
+    FatData.infoDirty = TRUE;
+
+    *count = n;
+
+    return first;
+}
+
+void Fat32FreeChain(uint32_t cluster)
+{
+    uint32_t n;
+    for(n = 0; n < FatData.clusterCount && cluster >= 2 && cluster < (FatData.clusterCount + 2); ++n)
+    {
+        uint32_t next = Fat32ReadEntry(cluster);
+
+        Fat32WriteEntry(cluster, 0);
+        if(FatData.freeMapValid)
+        {
+            FatData.freeMap[cluster / 32] &= ~(1 << (cluster % 32));
+        }
+        if(FatData.info->free_count != FSINFO_UNKNOWN)
+        {
+            FatData.info->free_count += 1;
+        }
+
+        cluster = next;
+    }
+
+    FatData.infoDirty = TRUE;
 }
 
 uint32_t Fat32AllocateDirEntries(dir_t* dir, uint32_t entries)
@@ -225,12 +620,12 @@ uint32_t Fat32AllocateDirEntries(dir_t* dir, uint32_t entries)
                 // Can we allocate more clusters?
                 if(i >= (DIRMAXCLUSTERS - 1))
                 {
-                    return E_ERROR;
+                    return -1;
                 }
                 // Allocate new cluster
                 nextCluster = Fat32AllocateCluster();
                 // Did we got a new cluster
-                if(nextCluster == 0x0FFFFFF7) return -1;
+                if(nextCluster == NOFREECLUSTER) return -1;
                 // Set FAT entries
                 Fat32WriteEntry(dir->curCluster, nextCluster);
                 Fat32WriteEntry(nextCluster, EOC);
@@ -240,7 +635,7 @@ uint32_t Fat32AllocateDirEntries(dir_t* dir, uint32_t entries)
             dir->sector = Fat32FirstSectorOfCluster(dir->curCluster);
 
             // Load dir cluster
-            if(mmc_bread(FatData.fd, dir->sector, DIRBUFFBLOCKS, dir->buff) == 0)
+            if(BcacheRead(dir->sector, DIRBUFFBLOCKS, dir->buff, 0) == 0)
             {
                 return -1;
             }
@@ -400,6 +795,98 @@ void Fat32WriteSfnEntry(dir_t* parent, uint32_t entry, uint8_t attr, uint32_t cl
     parent->dirty = TRUE;
 }
 
+uint32_t Fat32DcacheHash(const char* name, uint32_t len)
+{
+    // FNV-1a over the upper case name
+    uint32_t hash = 0x811C9DC5;
+    uint32_t i;
+    for(i = 0; i < len; ++i)
+    {
+        hash = (hash ^ (uint8_t)TO_UPPER_CASE(name[i])) * 0x01000193;
+    }
+
+    return hash;
+}
+
+fat_dentry_t* Fat32DcacheLookup(uint32_t parent, const char* name, uint32_t len, uint32_t hash)
+{
+    uint32_t i;
+    for(i = 0; i < DCACHEENTRIES; ++i)
+    {
+        fat_dentry_t* dentry = &FatData.dcache[i];
+        if(dentry->len == len && dentry->hash == hash && dentry->parent == parent && memcmp(dentry->name, name, len) == 0)
+        {
+            dentry->lru = ++FatData.dcacheTick;
+            return dentry;
+        }
+    }
+
+    return NULL;
+}
+
+void Fat32DcacheInsert(uint32_t parent, const char* name, uint32_t len, uint32_t hash, const dir_entry_t* entry)
+{
+    if(len == 0 || len > DCACHENAMEMAX)
+    {
+        return;
+    }
+
+    // Take an empty slot or the least recently used one
+    fat_dentry_t* victim = &FatData.dcache[0];
+    uint32_t i;
+    for(i = 0; i < DCACHEENTRIES; ++i)
+    {
+        if(FatData.dcache[i].len == 0)
+        {
+            victim = &FatData.dcache[i];
+            break;
+        }
+        if(FatData.dcache[i].lru < victim->lru)
+        {
+            victim = &FatData.dcache[i];
+        }
+    }
+
+    victim->parent = parent;
+    victim->hash = hash;
+    victim->len = len;
+    victim->lru = ++FatData.dcacheTick;
+    memcpy(victim->name, name, len);
+    memcpy(&victim->entry, entry, sizeof(dir_entry_t));
+}
+
+void Fat32DcacheInvalidate(uint32_t parent)
+{
+    uint32_t i;
+    for(i = 0; i < DCACHEENTRIES; ++i)
+    {
+        if(FatData.dcache[i].parent == parent)
+        {
+            FatData.dcache[i].len = 0;
+        }
+    }
+}
+
+void Fat32WriteFileAbort(dir_t* parent, uint32_t entry, uint32_t slots, uint32_t firstCluster)
+{
+    // Release the clusters chained so far
+    if(firstCluster != 0)
+    {
+        Fat32FreeChain(firstCluster);
+    }
+
+    // Drop the LFN entries already written, the SFN entry is only written on success
+    uint32_t i;
+    for(i = 0; i < (slots - 1); ++i)
+    {
+        ((dir_entry_t*)parent->buff)[entry + i].name[0] = 0xE5;
+    }
+    parent->dirty = TRUE;
+
+    Fat32FlushDir(parent);
+    Fat32FlushFat();
+}
+
 dir_entry_t* Fat32WriteFile(dir_t* parent, const char* name, uint32_t size, uint8_t attr, const uint8_t* buffer)
 {
     // Note 1: Private Function so no sanity checking is required
@@ -420,8 +907,18 @@ dir_entry_t* Fat32WriteFile(dir_t* parent, const char* name, uint32_t size, uint
     // We write in blocks of sector size, so we need to know how many sector we will write
     uint32_t sectors  = ROUND_UP_DIV(size, FatData.sectorSize);
 
+    // Clusters written below may have held the buffered file sector
+    FatData.fileSector = -1;
+
     // Now we need to allocate the required dir entries from parent directory
     uint32_t entry = Fat32AllocateDirEntries(parent, slots);
+    if(entry == (uint32_t)-1)
+    {
+        return NULL;
+    }
+
+    // Cached lookups in the parent are no longer trustworthy
+    Fat32DcacheInvalidate(parent->firstCluster);
 
     // At this point parent has buffer allocated for us to write the dir entries
 
@@ -437,31 +934,43 @@ dir_entry_t* Fat32WriteFile(dir_t* parent, const char* name, uint32_t size, uint
         Fat32WriteLfnEntry(parent, entry + i, &name[13 * (slots - 2 - i)], checksum, slots - (i + 1), (i == 0));
     }
 
-    // Allocate all needed clusters
-    uint32_t firstCluster = Fat32AllocateCluster();
-    uint32_t lastCluster = firstCluster;
+    // Allocate the clusters in contiguous runs, each run is written with a single command
+    uint32_t firstCluster = 0;
+    uint32_t lastCluster = 0;
+    uint32_t written = 0;
 
-    // Write file buffer to cluster
-    if(sectors > 0)
+    while(clusters > 0)
     {
-        uint32_t blocks = ((clusters > 1) ? (FatData.clusterSize) : (sectors));
-        mmc_bwrite(FatData.fd, Fat32FirstSectorOfCluster(firstCluster), blocks, buffer);
-        sectors -= blocks;
-    }
+        uint32_t count;
+        uint32_t run = Fat32AllocateRun(clusters, &count);
 
-    for(i = 1; i < clusters; ++i)
-    {
-        uint32_t newCluster = Fat32AllocateCluster();
-        // Write file buffer to cluster
-        uint32_t blocks = ((i < (clusters - 1)) ? (FatData.clusterSize) : (sectors));
-        mmc_bwrite(FatData.fd, Fat32FirstSectorOfCluster(newCluster), blocks, &buffer[i * FatData.clusterSize * FatData.sectorSize]);
-        sectors -= blocks;
-        // Set new cluster as next cluster in FAT
-        Fat32WriteEntry(lastCluster, newCluster);
-        lastCluster = newCluster;
-    }
+        if(run == NOFREECLUSTER)
+        {
+            Fat32WriteFileAbort(parent, entry, slots, firstCluster);
+            return NULL;
+        }
 
-    Fat32WriteEntry(lastCluster, EOC);
+        // Link run to the chain (the run itself is already chained)
+        if(lastCluster == 0) firstCluster = run;
+        else Fat32WriteEntry(lastCluster, run);
+
+        // Write file buffer to the run
+        uint32_t blocks = count * FatData.clusterSize;
+        if(blocks > sectors) blocks = sectors;
+        if(blocks > 0)
+        {
+            if(BcacheWrite(Fat32FirstSectorOfCluster(run), blocks, &buffer[written * FatData.sectorSize], BCACHE_BYPASS) != blocks)
+            {
+                Fat32WriteFileAbort(parent, entry, slots, firstCluster);
+                return NULL;
+            }
+            sectors -= blocks;
+            written += blocks;
+        }
+
+        lastCluster = run + count - 1;
+        clusters -= count;
+    }
 
     // Creat SFN entry
     Fat32WriteSfnEntry(parent, entry + (slots - 1), attr, firstCluster, size, sfn);
@@ -585,7 +1094,7 @@ int32_t Fat32SearchDir(dir_t* dir, const char* name, uint32_t size, dir_entry_t*
             dir->sector = Fat32FirstSectorOfCluster(dir->curCluster);
 
             // Load dir cluster
-            if(mmc_bread(FatData.fd, dir->sector, DIRBUFFBLOCKS, dir->buff) == 0)
+            if(BcacheRead(dir->sector, DIRBUFFBLOCKS, dir->buff, 0) == 0)
             {
                 return -1;
             }
@@ -635,15 +1144,12 @@ int32_t Fat32ResolvePath(dir_t* parent, const char* path, char** remaining, dir_
     }
     else
     {
+        // Directory clusters are only loaded when a search needs them
         if(dir->buff == NULL) dir->buff = DirBuffer;
         dir->sector = FatData.dataStartSector;
         dir->dirty  = FALSE;
         dir->firstCluster = FatData.rootCluster;
-        dir->curCluster   = dir->firstCluster;
-        if(mmc_bread(FatData.fd, dir->sector, DIRBUFFBLOCKS, dir->buff) == 0)
-        {
-            return E_ERROR;
-        }
+        dir->curCluster   = -1;
 
         // We need at least one '/'
         if(*ptr1 != '/')
@@ -672,26 +1178,38 @@ int32_t Fat32ResolvePath(dir_t* parent, const char* path, char** remaining, dir_
             }
         }
 
-        // Search current directory for next path entry
+        // Look for the entry in the dentry cache before searching the directory
         dir_entry_t* dir_entry;
-        if(Fat32SearchDir(dir, ptr1, len - 1, &dir_entry) != E_OK)
+        uint32_t hash = Fat32DcacheHash(ptr1, len);
+        fat_dentry_t* dentry = Fat32DcacheLookup(dir->firstCluster, ptr1, len, hash);
+
+        if(dentry != NULL)
         {
-            *remaining = ptr1;
-            return E_SRCH;
+            dir_entry = &dentry->entry;
         }
+        else
+        {
+            // Search current directory for next path entry
+            if(Fat32SearchDir(dir, ptr1, len - 1, &dir_entry) != E_OK)
+            {
+                *remaining = ptr1;
+                return E_SRCH;
+            }
 
-        // We found a dir move to it
-        dir->firstCluster = (dir_entry->starthi << 16) | (dir_entry->startlo);
-        dir->curCluster = dir->firstCluster;
-        dir->sector = Fat32FirstSectorOfCluster(dir->curCluster);
-        mmc_bread(FatData.fd, dir->sector, DIRBUFFBLOCKS, dir->buff);
-        dir->dirty = FALSE;
+            Fat32DcacheInsert(dir->firstCluster, ptr1, len, hash, dir_entry);
+        }
 
         if(entry != NULL)
         {
             memcpy(entry, dir_entry, sizeof(dir_entry_t));
         }
 
+        // We found a dir move to it
+        dir->firstCluster = (dir_entry->starthi << 16) | (dir_entry->startlo);
+        dir->curCluster = -1;
+        dir->sector = Fat32FirstSectorOfCluster(dir->firstCluster);
+        dir->dirty = FALSE;
+
         ptr1 += len;
     }
 }
@@ -740,7 +1258,7 @@ int32_t Fat32LoadNextCluster(dir_t* dir)
     dir->sector = Fat32FirstSectorOfCluster(dir->curCluster);
 
     // Load next cluster
-    if(mmc_bread(FatData.fd, dir->sector, DIRBUFFBLOCKS, dir->buff) == 0)
+    if(BcacheRead(dir->sector, DIRBUFFBLOCKS, dir->buff, 0) == 0)
     {
         return E_ERROR;
     }
@@ -748,14 +1266,91 @@ int32_t Fat32LoadNextCluster(dir_t* dir)
     return E_OK;
 }
 
+uint32_t Fat32FileCluster(fat32_file_t* file, uint32_t index)
+{
+    uint32_t i;
+
+    // Indexed part of the chain needs no FAT access
+    if(index < file->indexed)
+    {
+        for(i = 0; i < file->extents; ++i)
+        {
+            if(index < (file->extent[i].index + file->extent[i].count))
+            {
+                file->curIndex = index;
+                file->curCluster = file->extent[i].cluster + (index - file->extent[i].index);
+                return file->curCluster;
+            }
+        }
+    }
+
+    // Walk from the end of the index or from the cursor if it is further ahead
+    fat32_extent_t* last = &file->extent[file->extents - 1];
+    uint32_t pos = file->indexed - 1;
+    uint32_t cluster = last->cluster + last->count - 1;
+
+    if(file->curIndex > pos && file->curIndex <= index)
+    {
+        pos = file->curIndex;
+        cluster = file->curCluster;
+    }
+
+    while(pos < index)
+    {
+        uint32_t next = Fat32GetNextCluster(cluster);
+        if(next < 2 || next >= EOC)
+        {
+            return EOC;
+        }
+        pos += 1;
+
+        // Grow the index while the walk runs right past its end
+        if(pos == file->indexed)
+        {
+            if(next == (cluster + 1))
+            {
+                last->count += 1;
+                file->indexed += 1;
+            }
+            else if(file->extents < FAT32_FILE_EXTENTS)
+            {
+                last = &file->extent[file->extents++];
+                last->index = pos;
+                last->cluster = next;
+                last->count = 1;
+                file->indexed += 1;
+            }
+        }
+
+        cluster = next;
+    }
+
+    file->curIndex = pos;
+    file->curCluster = cluster;
+
+    return cluster;
+}
+
 /* Private functions -------------------------------------- */
 
-int32_t Fat32Init(uint32_t fd, uint32_t baseSector, uint8_t* buffer)
+int32_t Fat32Init(uint32_t fd, uint32_t baseSector, uint8_t* buffer, uint32_t size)
 {
     FatData.fd = fd;
 
+    if(size < (BCACHE_SIZE + BCACHE_BLOCK_SIZE))
+    {
+        return E_NO_MEMORY;
+    }
+
+    // The block cache takes the start of the buffer
+    if(BcacheInit(fd, buffer) != E_OK)
+    {
+        return E_ERROR;
+    }
+    buffer += BCACHE_SIZE;
+
     // Read Boot Sector and BPB
-    if(mmc_bread(FatData.fd, baseSector, 1, buffer) == 0)
+    if(BcacheRead(baseSector, 1, buffer, 0) == 0)
     {
         return E_ERROR;
     }
@@ -766,10 +1361,12 @@ int32_t Fat32Init(uint32_t fd, uint32_t baseSector, uint8_t* buffer)
     // Fat Offset
     FatData.fatOffset = boot_sector->hidden;
 
-    // FAT Buffer
-    FatData.fatBuff = NULL;
-    FatData.fatBuffNum = -1;
-    FatData.fatDirty = FALSE;
+    // FAT Windows
+    memset(FatData.fatWin, 0x0, sizeof(FatData.fatWin));
+    memset(&FatData.fatStats, 0x0, sizeof(FatData.fatStats));
+    FatData.fatCur = NULL;
+    FatData.fatLastBase = -1;
+    FatData.fatTick = 0;
     // Sector Info
     FatData.totalSectors = boot_sector->total_sect;
     FatData.sectorSize = boot_sector->sector_size;
@@ -786,16 +1383,60 @@ int32_t Fat32Init(uint32_t fd, uint32_t baseSector, uint8_t* buffer)
     FatData.rootCluster = boot_sector->root_cluster;
     // Data Area
     FatData.dataStartSector = (FatData.rootDirStartSector + FatData.rootDirSectors) + FatData.fatOffset;
+    // FSInfo
+    FatData.infoSector = ((boot_sector->info_sector != 0) ? (FatData.fatOffset + boot_sector->info_sector) : (0));
     // FAT sub-type
     delay_us(5);    // Workaround for weird crash before performing divisions
-    if(((FatData.totalSectors - FatData.dataStartSector) / FatData.clusterSize) < 65526)
+    FatData.clusterCount = (FatData.totalSectors - (FatData.dataStartSector - FatData.fatOffset)) / FatData.clusterSize;
+    if(FatData.clusterCount < 65525)
     {
         // Invalid type
         return E_ERROR;
     }
-    // Set Buffers
-    FatData.fatBuff = buffer;
-    DirBuffer = buffer + FATBUFFSIZE;
+    // Read ahead of metadata stays inside the partition
+    BcacheSetLimit(FatData.fatOffset + FatData.totalSectors);
+    // Set Buffers: FAT windows, directory, FSInfo and (if it fits) the free cluster map
+    uint32_t fixed = BCACHE_SIZE + (FAT32_FAT_WINDOWS * FATBUFFSIZE) + DIRBUFFSIZE + FatData.sectorSize + DCACHESIZE + FatData.sectorSize;
+    if(size < fixed)
+    {
+        return E_NO_MEMORY;
+    }
+
+    uint32_t i;
+    for(i = 0; i < FAT32_FAT_WINDOWS; ++i)
+    {
+        FatData.fatWin[i].base = -1;
+        FatData.fatWin[i].buff = buffer + (i * FATBUFFSIZE);
+    }
+    DirBuffer = buffer + (FAT32_FAT_WINDOWS * FATBUFFSIZE);
+    FatData.info = (fs_info_t*)(DirBuffer + DIRBUFFSIZE);
+    FatData.dcache = (fat_dentry_t*)(DirBuffer + DIRBUFFSIZE + FatData.sectorSize);
+    memset(FatData.dcache, 0x0, DCACHESIZE);
+    FatData.dcacheTick = 0;
+    FatData.fileBuff = (uint8_t*)FatData.dcache + DCACHESIZE;
+    FatData.fileSector = -1;
+    FatData.freeMap = (uint32_t*)(FatData.fileBuff + FatData.sectorSize);
+    FatData.freeMapValid = FALSE;
+    // The map build also needs room for one chunk of FAT sectors after the map
+    if((size - fixed) < ((FREEMAPWORDS * sizeof(uint32_t)) + (FREEMAPCHUNKBLOCKS * FatData.sectorSize)))
+    {
+        FatData.freeMap = NULL;
+    }
+
+    // Load FSInfo, without a valid one the hints start unknown
+    FatData.infoDirty = FALSE;
+    if(FatData.infoSector == 0 || BcacheRead(FatData.infoSector, 1, FatData.info, 0) != 1 ||
+       FatData.info->lead_sig != FSINFO_LEAD_SIG || FatData.info->struct_sig != FSINFO_STRUCT_SIG)
+    {
+        FatData.infoSector = 0;
+        FatData.info->free_count = FSINFO_UNKNOWN;
+        FatData.info->next_free = FSINFO_UNKNOWN;
+    }
+
+    if(FatData.info->next_free < 2 || FatData.info->next_free >= (FatData.clusterCount + 2))
+    {
+        FatData.info->next_free = 2;
+    }
 
     return E_OK;
 }
@@ -808,8 +1449,8 @@ int32_t Fat32Mkdir(const char* path)
     // Resolve path and get parent dir
     Fat32ResolvePath(NULL, path, &remaining, &parent, NULL);
 
-    // Check for unsupported charecters on remaining path
-    if(remaining == NULL || Fat32IsNameValid(remaining) != E_OK)
+    // Check for unsupported charecters on remaining path, an existing path leaves nothing
+    if(remaining == NULL || *remaining == '\0' || Fat32IsNameValid(remaining) != E_OK)
     {
         // Invalid path
         return E_INVAL;
@@ -833,7 +1474,7 @@ int32_t Fat32Mkdir(const char* path)
     dir.curCluster = dir.firstCluster;
     dir.sector = Fat32FirstSectorOfCluster(dir.curCluster);
     dir.buff = DirBuffer;
-    mmc_bread(FatData.fd, dir.sector, DIRBUFFBLOCKS, dir.buff);
+    BcacheRead(dir.sector, DIRBUFFBLOCKS, dir.buff, 0);
     dir.dirty = FALSE;
 
     // Make directory ".."
@@ -844,7 +1485,7 @@ int32_t Fat32Mkdir(const char* path)
 
     Fat32FlushDir(&dir);
 
-    return E_OK;
+    return BcacheFlush();
 }
 
 int32_t Fat32MkFile(const char* path, uint32_t size, const uint8_t* buffer)
@@ -855,10 +1496,10 @@ int32_t Fat32MkFile(const char* path, uint32_t size, const uint8_t* buffer)
     char* remaining = NULL;
     Fat32ResolvePath(NULL, path, &remaining, &parent, NULL);
 
-    // Check for unsupported charecters on remaining path
-    if(remaining == NULL || Fat32IsNameValid(remaining) != E_OK)
+    // An existing path resolves completely, there is no overwrite
+    if(remaining == NULL || *remaining == '\0' || Fat32IsNameValid(remaining) != E_OK)
     {
-        // Invalid directory name
+        // Invalid or existing file name
         return E_INVAL;
     }
     
@@ -875,45 +1516,158 @@ int32_t Fat32MkFile(const char* path, uint32_t size, const uint8_t* buffer)
 
     Fat32FlushDir(&parent);
 
-    return E_OK;
+    return BcacheFlush();
 }
 
-int32_t Fat32ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t size)
+int32_t Fat32Open(fat32_file_t* file, const char* path)
 {
-    (void)offset;
-
     dir_t dir = {0};
     dir_entry_t entry = {0};
 
     // Resolve path and get parent dir
     char* remaining = NULL;
-    if(Fat32ResolvePath(NULL, path, &remaining, &dir, &entry) != E_OK)
+    if(Fat32ResolvePath(NULL, path, &remaining, &dir, &entry) != E_OK || (entry.attr & ATTR_DIR))
     {
-        return 0;
+        return E_SRCH;
     }
 
-    if(size == (uint32_t)-1) size = entry.size;
+    memset(file, 0x0, sizeof(fat32_file_t));
+
+    file->firstCluster = (entry.starthi << 16) | (entry.startlo);
+    file->size = entry.size;
+    file->pos = 0;
+    file->curIndex = 0;
+    file->curCluster = file->firstCluster;
+
+    // Index starts with the first cluster
+    file->extents = 1;
+    file->extent[0].index = 0;
+    file->extent[0].cluster = file->firstCluster;
+    file->extent[0].count = 1;
+    file->indexed = 1;
+
+    return E_OK;
+}
 
+int32_t Fat32Read(fat32_file_t* file, uint8_t* buffer, uint32_t size)
+{
+    const uint32_t clusterBytes = FatData.clusterSize * FatData.sectorSize;
     uint32_t read = 0;
+
+    if(file->pos >= file->size || file->firstCluster < 2)
+    {
+        return 0;
+    }
+
+    if(size > (file->size - file->pos)) size = file->size - file->pos;
+
     while(read < size)
     {
-        uint32_t readSize = (((size - read) > DIRBUFFSIZE) ? (DIRBUFFSIZE) : (size - read));
+        uint32_t index = file->pos / clusterBytes;
+        uint32_t offset = file->pos % clusterBytes;
+        uint32_t cluster = Fat32FileCluster(file, index);
 
-        if((readSize + read) > entry.size) readSize = entry.size - read;
+        if(cluster >= EOC)
+        {
+            break;
+        }
 
-        memcpy(&buffer[read], dir.buff, DIRBUFFSIZE);
+        // Merge the following contiguous clusters while they are needed
+        uint32_t bytes = clusterBytes - offset;
+        uint32_t n;
+        for(n = 1; bytes < (size - read) && Fat32FileCluster(file, index + n) == (cluster + n); ++n)
+        {
+            bytes += clusterBytes;
+        }
+        if(bytes > (size - read)) bytes = size - read;
 
-        read += readSize;
+        uint32_t sector = Fat32FirstSectorOfCluster(cluster) + (offset / FatData.sectorSize);
+        uint32_t head = offset % FatData.sectorSize;
 
-        if(Fat32LoadNextCluster(&dir) != E_OK)
+        if(head != 0 || bytes < FatData.sectorSize)
         {
-            return read;
+            // Partial sector is kept in the file buffer so small sequential reads hit it
+            if(bytes > (FatData.sectorSize - head)) bytes = FatData.sectorSize - head;
+            if(FatData.fileSector != sector)
+            {
+                FatData.fileSector = -1;
+                if(BcacheRead(sector, 1, FatData.fileBuff, BCACHE_BYPASS) != 1)
+                {
+                    break;
+                }
+                FatData.fileSector = sector;
+            }
+            memcpy(&buffer[read], &FatData.fileBuff[head], bytes);
         }
+        else
+        {
+            // Whole sectors go straight to the caller's buffer
+            uint32_t sectors = bytes / FatData.sectorSize;
+            bytes = sectors * FatData.sectorSize;
+            if(BcacheRead(sector, sectors, &buffer[read], BCACHE_BYPASS) != sectors)
+            {
+                break;
+            }
+        }
+
+        read += bytes;
+        file->pos += bytes;
+    }
+
+    return read;
+}
+
+int32_t Fat32Seek(fat32_file_t* file, uint32_t offset)
+{
+    if(offset > file->size)
+    {
+        return E_INVAL;
+    }
+
+    file->pos = offset;
+
+    return E_OK;
+}
+
+int32_t Fat32Close(fat32_file_t* file)
+{
+    memset(file, 0x0, sizeof(fat32_file_t));
+
+    return E_OK;
+}
+
+int32_t Fat32ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t size)
+{
+    fat32_file_t file;
+
+    if(Fat32Open(&file, path) != E_OK)
+    {
+        return 0;
+    }
+
+    int32_t read = 0;
+    if(Fat32Seek(&file, offset) == E_OK)
+    {
+        read = Fat32Read(&file, buffer, size);
     }
 
+    (void)Fat32Close(&file);
+
     return read;
 }
 
+void Fat32GetCacheStats(fat32_cache_stats_t* stats)
+{
+    memcpy(stats, &FatData.fatStats, sizeof(fat32_cache_stats_t));
+}
+
+/* Card blocks of the mounted volume, count is 0 when nothing is mounted */
+void Fat32GetVolume(ulong_t* start, ulong_t* count)
+{
+    *start = FatData.fatOffset;
+    *count = FatData.totalSectors;
+}
+
 int32_t Fat32Stat(const char* path, struct stat* stat)
 {
     dir_t dir = {0};
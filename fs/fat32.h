@@ -18,6 +18,24 @@
 #include <types.h>
 
 
+/* Configuration ------------------------------------------ */
+
+/* FAT table cache */
+#define FAT32_FAT_WINDOWS       16  /* Number of FAT windows */
+#define FAT32_FAT_WINDOW_BLOCKS 8   /* Sectors per FAT window */
+
+/* Directory entry cache */
+#define FAT32_DCACHE_ENTRIES    64  /* Cached path components */
+#define FAT32_DCACHE_NAME_MAX   64  /* Longer names are looked up without the cache */
+
+/* File handles */
+/* Extents indexed per open file. Once they are used up the index stops growing:
+ * reads past it still follow the chain from the cursor, so sequential reads keep
+ * costing one FAT lookup per cluster, but seeking back past the indexed part walks
+ * the chain again from the end of the index. */
+#define FAT32_FILE_EXTENTS      16
+
+
 /* Exported types ----------------------------------------- */
 typedef struct boot_sector
 {
@@ -46,6 +64,17 @@ typedef struct boot_sector
     uint16_t reserved2[6];      /* Unused */
 } __attribute__ ((__packed__)) boot_sector_t;
 
+typedef struct fs_info
+{
+    uint32_t lead_sig;          /* 0x41615252 */
+    uint8_t  reserved1[480];    /* Unused */
+    uint32_t struct_sig;        /* 0x61417272 */
+    uint32_t free_count;        /* Last known free cluster count */
+    uint32_t next_free;         /* Hint for the next free cluster */
+    uint8_t  reserved2[12];     /* Unused */
+    uint32_t trail_sig;         /* 0xAA550000 */
+} __attribute__ ((__packed__)) fs_info_t;
+
 typedef struct volume_info
 {
     uint8_t  drive_number;      /* BIOS drive number */
@@ -103,6 +132,35 @@ struct stat
     uint32_t st_blocks;  /* number of 512B blocks allocated */
 };
 
+typedef struct
+{
+    uint32_t hits;          /* FAT sector found in a window */
+    uint32_t misses;        /* FAT window loaded on demand */
+    uint32_t readaheads;    /* FAT window loaded ahead of a sequential walk */
+    uint32_t writebacks;    /* Dirty FAT windows written */
+}fat32_cache_stats_t;
+
+typedef struct
+{
+    uint32_t index;         /* File cluster index of the first cluster */
+    uint32_t cluster;       /* First cluster of the extent */
+    uint32_t count;         /* Contiguous clusters in the extent */
+}fat32_extent_t;
+
+typedef struct
+{
+    uint32_t firstCluster;
+    uint32_t size;
+    uint32_t pos;           /* Cursor in bytes */
+    // Cached cursor cluster
+    uint32_t curIndex;
+    uint32_t curCluster;
+    // Cluster position index, covers the first 'indexed' clusters of the chain (see FAT32_FILE_EXTENTS)
+    uint32_t indexed;
+    uint32_t extents;
+    fat32_extent_t extent[FAT32_FILE_EXTENTS];
+}fat32_file_t;
+
 /* Exported constants ------------------------------------- */
 #define EOC     0xffffff8
 
@@ -120,14 +178,29 @@ struct stat
 
 /* Exported functions ------------------------------------- */
 
-int32_t Fat32Init(uint32_t fd, uint32_t baseSector, uint8_t* buffer);
+int32_t Fat32Init(uint32_t fd, uint32_t baseSector, uint8_t* buffer, uint32_t size);
 
 int32_t Fat32Mkdir(const char* path);
 
+/* buffer is written in whole sectors, it has to hold size rounded up to 512 bytes */
 int32_t Fat32MkFile(const char* path, uint32_t size, const uint8_t* buffer);
 
 int32_t Fat32ReadFile(const char* path, uint8_t* buffer, uint32_t offset, uint32_t size);
 
+int32_t Fat32Stat(const char* path, struct stat* stat);
+
+int32_t Fat32Open(fat32_file_t* file, const char* path);
+
+int32_t Fat32Read(fat32_file_t* file, uint8_t* buffer, uint32_t size);
+
+int32_t Fat32Seek(fat32_file_t* file, uint32_t offset);
+
+int32_t Fat32Close(fat32_file_t* file);
+
+void Fat32GetCacheStats(fat32_cache_stats_t* stats);
+
+void Fat32GetVolume(ulong_t* start, ulong_t* count);
+
 #ifdef __cplusplus
     }
 #endif
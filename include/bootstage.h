@@ -0,0 +1,63 @@
+/**
+ * @file        bootstage.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Boot stage profiler Header File
+*/
+
+#ifndef _BOOTSTAGE_H_
+#define _BOOTSTAGE_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+/* Exported constants ------------------------------------- */
+
+#define BOOTSTAGE_MAGIC         (0x53544742)    // "BGTS"
+#define BOOTSTAGE_MAX_RECORDS   (32)
+#define BOOTSTAGE_NAME_SIZE     (24)
+
+/* Table copy handed to the next stage (see BOOTSTAGE=dram in the Makefile) */
+#define BOOTSTAGE_DRAM_ADDR     (0x4FFF0000)
+
+
+/* Exported types ----------------------------------------- */
+
+typedef struct
+{
+    uint64_t ticks;                         /* System counter value */
+    char     name[BOOTSTAGE_NAME_SIZE];     /* NUL terminated stage name */
+}bootstage_record_t;
+
+typedef struct
+{
+    uint32_t magic;                         /* BOOTSTAGE_MAGIC */
+    uint32_t freq;                          /* System counter frequency in Hz */
+    uint32_t count;                         /* Valid records */
+    uint32_t dropped;                       /* Marks lost because the table was full */
+    bootstage_record_t record[BOOTSTAGE_MAX_RECORDS];
+}bootstage_table_t;
+
+
+/* Exported macros ---------------------------------------- */
+
+
+/* Exported functions ------------------------------------- */
+
+void bootstage_mark(const char* name);
+
+void bootstage_relocate(void);
+
+void bootstage_report(void);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _BOOTSTAGE_H_ */
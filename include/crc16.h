@@ -0,0 +1,36 @@
+/**
+ * @file        crc16.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       CRC16-CCITT (XMODEM variant) Header File
+*/
+
+#ifndef _CRC16_H_
+#define _CRC16_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported functions ------------------------------------- */
+
+/**
+ * @brief	Update a CRC16-CCITT (polynomial 0x1021, MSB first), start with crc = 0
+ * @param	crc - CRC of the previous data
+ * 			buf - data
+ * 			len - data length in bytes
+ * @retval	Updated CRC
+ */
+uint16_t crc16_ccitt(uint16_t crc, const void* buf, uint32_t len);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _CRC16_H_ */
@@ -0,0 +1,36 @@
+/**
+ * @file        crc32.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       CRC32 (IEEE 802.3, same as zlib) Header File
+*/
+
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported functions ------------------------------------- */
+
+/**
+ * @brief	Update a CRC32 with a buffer, start with crc = 0
+ * @param	crc - CRC of the previous data
+ * 			buf - data
+ * 			len - data length in bytes
+ * @retval	Updated CRC
+ */
+uint32_t crc32(uint32_t crc, const void* buf, uint32_t len);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _CRC32_H_ */
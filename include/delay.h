@@ -19,6 +19,11 @@
 
 /* Exported types ----------------------------------------- */
 
+typedef struct
+{
+    uint64_t end;       /* System counter value at which the deadline expires */
+}deadline_t;
+
 
 /* Exported constants ------------------------------------- */
 
@@ -28,8 +33,24 @@
 
 /* Exported functions ------------------------------------- */
 
+void delay_init(void);
+
+uint64_t time_get_ticks(void);
+
+uint64_t time_ticks_to_us(uint64_t ticks);
+
+uint64_t time_get_us(void);
+
+uint64_t time_get_ns(void);
+
 void delay_us(uint32_t us);
 
+void deadline_set_us(deadline_t* deadline, uint32_t us);
+
+void deadline_set_ms(deadline_t* deadline, uint32_t ms);
+
+bool_t deadline_expired(const deadline_t* deadline);
+
 #ifdef __cplusplus
     }
 #endif
@@ -0,0 +1,102 @@
+/**
+ * @file        lz4.h
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Streaming LZ4 frame decoder Header File
+*/
+
+#ifndef _LZ4_H_
+#define _LZ4_H_
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Includes ----------------------------------------------- */
+#include <types.h>
+
+
+/* Exported constants ------------------------------------- */
+
+#define LZ4_FRAME_MAGIC         (0x184D2204)
+
+
+/* Exported types ----------------------------------------- */
+
+/* Running xxHash32, blocks arrive in pieces */
+typedef struct
+{
+    uint32_t v[4];
+    uint32_t len;               /* Bytes hashed */
+    uint8_t  buf[16];           /* Bytes waiting for a whole stripe */
+}lz4_xxh32_t;
+
+/* Decoder state, the whole output stays in memory so matches are copied from
+ * the output itself and no history window is kept */
+typedef struct
+{
+    uint8_t *dst;               /* Start of the output */
+    uint8_t *out;               /* Next output byte */
+    uint8_t *end;               /* End of the output buffer */
+    uint8_t *frame;             /* Output of the current frame */
+    uint32_t state;
+    uint8_t  field[16];         /* Multi byte field being collected */
+    uint32_t count;             /* Bytes in field */
+    uint32_t need;              /* Bytes the field needs */
+    uint32_t flags;             /* Frame descriptor FLG */
+    uint32_t blockMax;          /* Maximum block size */
+    uint32_t blockLeft;         /* Input bytes left in the block */
+    uint32_t contentSize;       /* From the descriptor, 0 if not present */
+    uint32_t litLen;
+    uint32_t matchLen;
+    uint32_t offset;            /* Match offset */
+    uint32_t skip;              /* Bytes left in a skippable frame */
+    uint32_t frames;            /* Frames completed */
+    lz4_xxh32_t blockHash;      /* Compressed data of the current block */
+}lz4_stream_t;
+
+
+/* Exported functions ------------------------------------- */
+
+/**
+ * @brief	Check for the LZ4 frame magic number
+ * @param	buf - at least 4 bytes
+ * @retval	TRUE if buf starts an LZ4 frame
+ */
+bool_t lz4_is_frame(const void* buf);
+
+/**
+ * @brief	Start decoding into dst
+ * @param	stream - decoder state
+ * 			dst - output buffer
+ * 			size - output buffer size
+ * @retval	No return value
+ */
+void lz4_stream_init(lz4_stream_t* stream, void* dst, uint32_t size);
+
+/**
+ * @brief	Decode the next piece of the input, any split is allowed
+ * @param	stream - decoder state
+ * 			src - compressed data
+ * 			len - compressed data length
+ * @retval	E_OK, E_ERROR for corrupted input, E_NO_MEMORY if the output
+ * 			does not fit
+ */
+int32_t lz4_stream_write(lz4_stream_t* stream, const void* src, uint32_t len);
+
+/**
+ * @brief	Check the input ended on a frame boundary (up to 3 zero bytes of
+ * 			padding are accepted)
+ * @param	stream - decoder state
+ * 			size - receives the decompressed size
+ * @retval	E_OK or E_ERROR if the input was truncated
+ */
+int32_t lz4_stream_finish(lz4_stream_t* stream, uint32_t* size);
+
+#ifdef __cplusplus
+    }
+#endif
+
+#endif /* _LZ4_H_ */
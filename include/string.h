@@ -15,4 +15,8 @@ int32_t strcmp(const void *s1, const void *s2);
 
 char *strcpy(char *dst, const char *src);
 
+#ifdef CONFIG_STRING_BENCH
+void StringBench(void);
+#endif
+
 #endif
\ No newline at end of file
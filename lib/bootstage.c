@@ -0,0 +1,123 @@
+/**
+ * @file        bootstage.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Boot stage profiler: named timestamps on the system counter
+*/
+
+
+
+/* Includes ----------------------------------------------- */
+#include <bootstage.h>
+#include <delay.h>
+#include <gtimer.h>
+#include <string.h>
+#include <serial.h>
+#include <helper.h>
+
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+static bootstage_table_t BootStageSram;
+
+static bootstage_table_t* BootStage = &BootStageSram;
+
+
+/* Private function prototypes ---------------------------- */
+
+static void bootstage_put_us(uint64_t us)
+{
+    char str[11];
+    uint32_t len = strlen(itoa((int32_t)us, str, 10));
+
+    // Right align in 10 columns
+    for(; len < 10; ++len)
+    {
+        puts(" ");
+    }
+    puts(str);
+}
+
+
+/* Private functions -------------------------------------- */
+
+void bootstage_mark(const char* name)
+{
+    uint64_t ticks = time_get_ticks();
+
+    if(BootStage->magic != BOOTSTAGE_MAGIC)
+    {
+        BootStage->magic = BOOTSTAGE_MAGIC;
+        BootStage->freq = gtimer_get_freq();
+        BootStage->count = 0;
+        BootStage->dropped = 0;
+    }
+
+    if(BootStage->count >= BOOTSTAGE_MAX_RECORDS)
+    {
+        BootStage->dropped += 1;
+        return;
+    }
+
+    bootstage_record_t* record = &BootStage->record[BootStage->count++];
+    uint32_t i;
+    for(i = 0; i < (BOOTSTAGE_NAME_SIZE - 1) && name[i] != '\0'; ++i)
+    {
+        record->name[i] = name[i];
+    }
+    record->name[i] = '\0';
+    record->ticks = ticks;
+}
+
+void bootstage_relocate(void)
+{
+#ifdef CONFIG_BOOTSTAGE_DRAM
+    // Keep recording in DRAM so the next stage finds the full table there
+    bootstage_table_t* table = (bootstage_table_t*)BOOTSTAGE_DRAM_ADDR;
+
+    memcpy(table, &BootStageSram, sizeof(bootstage_table_t));
+    BootStage = table;
+#endif
+}
+
+void bootstage_report(void)
+{
+    uint64_t prev = 0;
+    uint32_t i;
+
+    puts("     time(us)  delta(us)  stage\n");
+    for(i = 0; i < BootStage->count; ++i)
+    {
+        uint64_t ticks = BootStage->record[i].ticks;
+
+        puts("  ");
+        bootstage_put_us(time_ticks_to_us(ticks));
+        puts(" ");
+        bootstage_put_us(((i > 0) ? (time_ticks_to_us(ticks - prev)) : (0)));
+        puts("  ");
+        puts(BootStage->record[i].name);
+        puts("\n");
+
+        prev = ticks;
+    }
+
+    if(BootStage->dropped)
+    {
+        char str[11];
+        puts("Dropped marks: ");
+        puts(itoa(BootStage->dropped, str, 10));
+        puts("\n");
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * @file        crc16.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       CRC16-CCITT (XMODEM variant)
+*/
+
+
+
+/* Includes ----------------------------------------------- */
+#include <crc16.h>
+
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+#define CRC16_POLY		(0x1021)
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+
+
+/* Private function prototypes ---------------------------- */
+
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * crc16_ccitt Implementation (See header file for description)
+*/
+uint16_t crc16_ccitt(uint16_t crc, const void* buf, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    uint32_t i;
+
+    while(len--)
+    {
+        crc ^= (uint16_t)(*p++) << 8;
+        for(i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ CRC16_POLY) : (crc << 1);
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file        crc32.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       CRC32 (IEEE 802.3, same as zlib)
+*/
+
+
+
+/* Includes ----------------------------------------------- */
+#include <crc32.h>
+
+
+/* Private types ------------------------------------------ */
+
+
+
+/* Private constants -------------------------------------- */
+
+#define CRC32_POLY		(0xEDB88320)	/* Reversed 0x04C11DB7 */
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+/* Built on first use, keeps 1KB of constants out of the image */
+static uint32_t Crc32Table[256];
+static bool_t Crc32TableReady = FALSE;
+
+
+/* Private function prototypes ---------------------------- */
+
+static void crc32_init(void)
+{
+    uint32_t i;
+    uint32_t j;
+
+    for(i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for(j = 0; j < 8; j++)
+        {
+            c = (c & 1) ? (CRC32_POLY ^ (c >> 1)) : (c >> 1);
+        }
+        Crc32Table[i] = c;
+    }
+    Crc32TableReady = TRUE;
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * crc32 Implementation (See header file for description)
+*/
+uint32_t crc32(uint32_t crc, const void* buf, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+
+    if(!Crc32TableReady)
+    {
+        crc32_init();
+    }
+
+    crc = ~crc;
+    while(len--)
+    {
+        crc = Crc32Table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
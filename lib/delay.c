@@ -10,11 +10,16 @@
 
 /* Includes ----------------------------------------------- */
 #include <delay.h>
-#include <pmu.h>
+#include <gtimer.h>
 
 
 /* Private types ------------------------------------------ */
 
+typedef struct
+{
+    uint32_t whole;     // Integer part of the factor
+    uint32_t frac;      // Fractional part of the factor (1/2^32 units)
+}time_scale_t;
 
 
 /* Private constants -------------------------------------- */
@@ -26,27 +31,110 @@
 
 
 /* Private variables -------------------------------------- */
-
+static struct
+{
+    uint32_t     freq;
+    time_scale_t ticksToUs;
+    time_scale_t ticksToNs;
+    time_scale_t usToTicks;
+}TimeBase;
 
 
 /* Private function prototypes ---------------------------- */
 
+static void time_scale_init(time_scale_t* scale, uint32_t num, uint32_t den)
+{
+    uint32_t rem = num % den;
+    uint32_t frac = 0;
+    uint32_t i;
 
+    scale->whole = num / den;
 
-/* Private functions -------------------------------------- */
+    // frac = (rem << 32) / den by long division, no 64-bit divide needed
+    for(i = 0; i < 32; ++i)
+    {
+        uint32_t carry = rem >> 31;
+        rem <<= 1;
+        frac <<= 1;
+        if(carry || rem >= den)
+        {
+            rem -= den;
+            frac |= 1;
+        }
+    }
 
-void delay_us(uint32_t us)
+    scale->frac = frac;
+}
+
+static uint64_t time_scale(uint64_t value, const time_scale_t* scale)
 {
-    uint32_t us_cnt = 0;
-    uint32_t cur = 0;
-    uint32_t target = 0;
+    uint32_t hi = (uint32_t)(value >> 32);
+    uint32_t lo = (uint32_t)value;
+
+    return (value * scale->whole) + ((uint64_t)hi * scale->frac) + (((uint64_t)lo * scale->frac) >> 32);
+}
+
+
+/* Private functions -------------------------------------- */
 
-    us_cnt = pmu_us2ticks(us);
-    cur = pmu_get_cyclecount();
-    target = cur - pmu_overheadCall() + us_cnt;
+void delay_init(void)
+{
+    uint32_t freq = gtimer_get_freq();
 
-    while(!(((int32_t)(cur) - (int32_t)(target) >= 0)))
+    // Boot ROM leaves CNTFRQ unprogrammed, the counter itself runs from the 24MHz oscillator
+    if(freq == 0)
     {
-        cur = pmu_get_cyclecount();
+        freq = GTIMER_DEFAULT_FREQ;
+        gtimer_set_freq(freq);
     }
+
+    TimeBase.freq = freq;
+    time_scale_init(&TimeBase.ticksToUs, 1000000, freq);
+    time_scale_init(&TimeBase.ticksToNs, 1000000000, freq);
+    time_scale_init(&TimeBase.usToTicks, freq, 1000000);
+}
+
+uint64_t time_get_ticks(void)
+{
+    return gtimer_get_count();
+}
+
+uint64_t time_ticks_to_us(uint64_t ticks)
+{
+    return time_scale(ticks, &TimeBase.ticksToUs);
+}
+
+uint64_t time_get_us(void)
+{
+    return time_scale(gtimer_get_count(), &TimeBase.ticksToUs);
+}
+
+uint64_t time_get_ns(void)
+{
+    return time_scale(gtimer_get_count(), &TimeBase.ticksToNs);
+}
+
+void delay_us(uint32_t us)
+{
+    deadline_t deadline;
+
+    deadline_set_us(&deadline, us);
+
+    while(!deadline_expired(&deadline));
+}
+
+void deadline_set_us(deadline_t* deadline, uint32_t us)
+{
+    deadline->end = gtimer_get_count() + time_scale(us, &TimeBase.usToTicks);
+}
+
+void deadline_set_ms(deadline_t* deadline, uint32_t ms)
+{
+    deadline->end = gtimer_get_count() + time_scale((uint64_t)ms * 1000, &TimeBase.usToTicks);
+}
+
+bool_t deadline_expired(const deadline_t* deadline)
+{
+    // 64-bit counter, wrapping is not a concern
+    return (gtimer_get_count() >= deadline->end);
 }
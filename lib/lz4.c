@@ -0,0 +1,618 @@
+/**
+ * @file        lz4.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Streaming LZ4 frame decoder. The input can be split anywhere,
+ *              output is written with memcpy (NEON 32 byte stores)
+*/
+
+
+
+/* Includes ----------------------------------------------- */
+#include <lz4.h>
+#include <string.h>
+#include <misc.h>
+
+
+/* Private types ------------------------------------------ */
+
+enum
+{
+    LZ4_STATE_MAGIC,
+    LZ4_STATE_SKIP_SIZE,
+    LZ4_STATE_SKIP,
+    LZ4_STATE_DESCRIPTOR,
+    LZ4_STATE_BLOCK_SIZE,
+    LZ4_STATE_TOKEN,            /* TOKEN to RAW: reading the block data */
+    LZ4_STATE_LITLEN,
+    LZ4_STATE_LITERALS,
+    LZ4_STATE_OFFSET,
+    LZ4_STATE_MATCHLEN,
+    LZ4_STATE_RAW,
+    LZ4_STATE_BLOCK_CHECKSUM,
+    LZ4_STATE_CONTENT_CHECKSUM,
+    LZ4_STATE_ERROR,
+};
+
+
+/* Private constants -------------------------------------- */
+
+#define LZ4_SKIP_MAGIC          (0x184D2A50)    /* Low nibble is free */
+#define LZ4_SKIP_MASK           (0xFFFFFFF0)
+
+/* Frame descriptor FLG */
+#define LZ4_FLG_VERSION_MASK    (0xC0)
+#define LZ4_FLG_VERSION         (0x40)
+#define LZ4_FLG_BLOCK_CHECKSUM  (0x10)
+#define LZ4_FLG_CONTENT_SIZE    (0x08)
+#define LZ4_FLG_CONTENT_CHECKSUM (0x04)
+#define LZ4_FLG_DICT_ID         (0x01)
+
+#define LZ4_BLOCK_RAW           (0x80000000)
+#define LZ4_MIN_MATCH           (4)
+
+/* xxHash32 primes */
+#define XXH_P1                  (2654435761U)
+#define XXH_P2                  (2246822519U)
+#define XXH_P3                  (3266489917U)
+#define XXH_P4                  (668265263U)
+#define XXH_P5                  (374761393U)
+
+
+/* Private macros ----------------------------------------- */
+
+#define ROTL32(x, r)            (((x) << (r)) | ((x) >> (32 - (r))))
+
+
+/* Private variables -------------------------------------- */
+
+
+
+/* Private function prototypes ---------------------------- */
+
+static inline uint32_t lz4_le32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void lz4_xxh32_init(lz4_xxh32_t* x)
+{
+    x->v[0] = XXH_P1 + XXH_P2;
+    x->v[1] = XXH_P2;
+    x->v[2] = 0;
+    x->v[3] = -XXH_P1;
+    x->len = 0;
+}
+
+static inline void lz4_xxh32_stripe(uint32_t* v, const uint8_t* p)
+{
+    v[0] = ROTL32(v[0] + lz4_le32(p) * XXH_P2, 13) * XXH_P1;
+    v[1] = ROTL32(v[1] + lz4_le32(p + 4) * XXH_P2, 13) * XXH_P1;
+    v[2] = ROTL32(v[2] + lz4_le32(p + 8) * XXH_P2, 13) * XXH_P1;
+    v[3] = ROTL32(v[3] + lz4_le32(p + 12) * XXH_P2, 13) * XXH_P1;
+}
+
+static void lz4_xxh32_update(lz4_xxh32_t* x, const uint8_t* p, uint32_t len)
+{
+    uint32_t fill = x->len & 15;
+
+    x->len += len;
+
+    /* Complete the stripe left by the previous piece */
+    if(fill != 0)
+    {
+        uint32_t n = min(16 - fill, len);
+        memcpy(&x->buf[fill], p, n);
+        p += n;
+        len -= n;
+        if((fill + n) < 16)
+        {
+            return;
+        }
+        lz4_xxh32_stripe(x->v, x->buf);
+    }
+
+    for(; len >= 16; p += 16, len -= 16)
+    {
+        lz4_xxh32_stripe(x->v, p);
+    }
+
+    memcpy(x->buf, p, len);
+}
+
+static uint32_t lz4_xxh32_digest(const lz4_xxh32_t* x)
+{
+    const uint8_t *p = x->buf;
+    const uint8_t *end = p + (x->len & 15);
+    uint32_t h;
+
+    if(x->len >= 16)
+    {
+        h = ROTL32(x->v[0], 1) + ROTL32(x->v[1], 7) + ROTL32(x->v[2], 12) + ROTL32(x->v[3], 18);
+    }
+    else
+    {
+        h = XXH_P5;
+    }
+
+    h += x->len;
+
+    while(p + 4 <= end)
+    {
+        h = ROTL32(h + lz4_le32(p) * XXH_P3, 17) * XXH_P4;
+        p += 4;
+    }
+    while(p < end)
+    {
+        h = ROTL32(h + (*p) * XXH_P5, 11) * XXH_P1;
+        p++;
+    }
+
+    h ^= h >> 15;
+    h *= XXH_P2;
+    h ^= h >> 13;
+    h *= XXH_P3;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static uint32_t lz4_xxh32(const uint8_t* p, uint32_t len)
+{
+    lz4_xxh32_t x;
+
+    lz4_xxh32_init(&x);
+    lz4_xxh32_update(&x, p, len);
+
+    return lz4_xxh32_digest(&x);
+}
+
+/* Compressed block data is being read and has to be hashed */
+static inline bool_t lz4_block_hashed(const lz4_stream_t* s)
+{
+    return ((s->flags & LZ4_FLG_BLOCK_CHECKSUM) && s->state >= LZ4_STATE_TOKEN && s->state <= LZ4_STATE_RAW);
+}
+
+static inline void lz4_collect(lz4_stream_t* s, uint32_t state, uint32_t need)
+{
+    s->state = state;
+    s->count = 0;
+    s->need = need;
+}
+
+static inline void lz4_block_end(lz4_stream_t* s)
+{
+    if(s->flags & LZ4_FLG_BLOCK_CHECKSUM)
+    {
+        lz4_collect(s, LZ4_STATE_BLOCK_CHECKSUM, 4);
+    }
+    else
+    {
+        lz4_collect(s, LZ4_STATE_BLOCK_SIZE, 4);
+    }
+}
+
+static int32_t lz4_frame_end(lz4_stream_t* s)
+{
+    if(s->contentSize != 0 && (uint32_t)(s->out - s->frame) != s->contentSize)
+    {
+        return E_ERROR;
+    }
+
+    s->frames++;
+    lz4_collect(s, LZ4_STATE_MAGIC, 4);
+    return E_OK;
+}
+
+/* Copy a match, offset was checked against the output already written */
+static int32_t lz4_match(lz4_stream_t* s, uint32_t offset)
+{
+    uint32_t len = s->matchLen + LZ4_MIN_MATCH;
+    const uint8_t *ref = s->out - offset;
+
+    if(len > (uint32_t)(s->end - s->out))
+    {
+        return E_NO_MEMORY;
+    }
+
+    /* Overlapping matches repeat the last offset bytes, copy the pattern in
+     * chunks that double every time so each memcpy is non overlapping */
+    while(len)
+    {
+        uint32_t n = min(len, (uint32_t)(s->out - ref));
+        memcpy(s->out, ref, n);
+        s->out += n;
+        len -= n;
+    }
+
+    if(s->blockLeft == 0)
+    {
+        lz4_block_end(s);
+    }
+    else
+    {
+        s->state = LZ4_STATE_TOKEN;
+    }
+
+    return E_OK;
+}
+
+/* A multi byte field is complete */
+static int32_t lz4_field(lz4_stream_t* s)
+{
+    uint8_t *f = s->field;
+
+    switch(s->state)
+    {
+    case LZ4_STATE_MAGIC:
+    {
+        uint32_t magic = lz4_le32(f);
+        if(magic == LZ4_FRAME_MAGIC)
+        {
+            /* FLG and BD first, they tell the descriptor size */
+            lz4_collect(s, LZ4_STATE_DESCRIPTOR, 2);
+        }
+        else if((magic & LZ4_SKIP_MASK) == LZ4_SKIP_MAGIC)
+        {
+            lz4_collect(s, LZ4_STATE_SKIP_SIZE, 4);
+        }
+        else
+        {
+            return E_ERROR;
+        }
+        break;
+    }
+    case LZ4_STATE_SKIP_SIZE:
+    {
+        s->skip = lz4_le32(f);
+        if(s->skip == 0)
+        {
+            lz4_collect(s, LZ4_STATE_MAGIC, 4);
+        }
+        else
+        {
+            s->state = LZ4_STATE_SKIP;
+        }
+        break;
+    }
+    case LZ4_STATE_DESCRIPTOR:
+    {
+        uint32_t flags = f[0];
+
+        if(s->need == 2)
+        {
+            if((flags & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION || (flags & LZ4_FLG_DICT_ID))
+            {
+                return E_ERROR;
+            }
+            s->need = 2 + ((flags & LZ4_FLG_CONTENT_SIZE) ? (8) : (0)) + 1;
+            return E_OK;
+        }
+
+        /* Header checksum: second byte of the xxh32 of the descriptor */
+        if(((lz4_xxh32(f, s->need - 1) >> 8) & 0xFF) != f[s->need - 1])
+        {
+            return E_ERROR;
+        }
+
+        uint32_t bsize = (f[1] >> 4) & 0x7;
+        if(bsize < 4)
+        {
+            return E_ERROR;
+        }
+        s->blockMax = (1 << (8 + (2 * bsize)));     /* 64KB, 256KB, 1MB, 4MB */
+
+        s->contentSize = 0;
+        if(flags & LZ4_FLG_CONTENT_SIZE)
+        {
+            if(f[6] | f[7] | f[8] | f[9])
+            {
+                return E_NO_MEMORY;
+            }
+            s->contentSize = lz4_le32(&f[2]);
+            if(s->contentSize > (uint32_t)(s->end - s->out))
+            {
+                return E_NO_MEMORY;
+            }
+        }
+
+        s->flags = flags;
+        s->frame = s->out;
+        lz4_collect(s, LZ4_STATE_BLOCK_SIZE, 4);
+        break;
+    }
+    case LZ4_STATE_BLOCK_SIZE:
+    {
+        uint32_t size = lz4_le32(f);
+
+        if(size == 0)
+        {
+            /* End mark */
+            if(s->flags & LZ4_FLG_CONTENT_CHECKSUM)
+            {
+                lz4_collect(s, LZ4_STATE_CONTENT_CHECKSUM, 4);
+                break;
+            }
+            return lz4_frame_end(s);
+        }
+
+        s->blockLeft = size & ~LZ4_BLOCK_RAW;
+        if(s->blockLeft > s->blockMax)
+        {
+            return E_ERROR;
+        }
+        s->state = ((size & LZ4_BLOCK_RAW) ? (LZ4_STATE_RAW) : (LZ4_STATE_TOKEN));
+        lz4_xxh32_init(&s->blockHash);
+        break;
+    }
+    case LZ4_STATE_OFFSET:
+    {
+        uint32_t offset = f[0] | (f[1] << 8);
+
+        if(offset == 0 || offset > (uint32_t)(s->out - s->dst))
+        {
+            return E_ERROR;
+        }
+        s->offset = offset;
+
+        if(s->matchLen == 15)
+        {
+            s->state = LZ4_STATE_MATCHLEN;
+            break;
+        }
+        return lz4_match(s, offset);
+    }
+    case LZ4_STATE_BLOCK_CHECKSUM:
+    {
+        /* xxh32 of the compressed data, frames without a content checksum
+         * are only protected by it */
+        if(lz4_xxh32_digest(&s->blockHash) != lz4_le32(f))
+        {
+            return E_ERROR;
+        }
+        lz4_collect(s, LZ4_STATE_BLOCK_SIZE, 4);
+        break;
+    }
+    case LZ4_STATE_CONTENT_CHECKSUM:
+    {
+        if(lz4_xxh32(s->frame, s->out - s->frame) != lz4_le32(f))
+        {
+            return E_ERROR;
+        }
+        return lz4_frame_end(s);
+    }
+    default:
+        return E_ERROR;
+    }
+
+    return E_OK;
+}
+
+
+/* Private functions -------------------------------------- */
+
+/**
+ * lz4_is_frame Implementation (See header file for description)
+*/
+bool_t lz4_is_frame(const void* buf)
+{
+    return (lz4_le32((const uint8_t *)buf) == LZ4_FRAME_MAGIC);
+}
+
+/**
+ * lz4_stream_init Implementation (See header file for description)
+*/
+void lz4_stream_init(lz4_stream_t* stream, void* dst, uint32_t size)
+{
+    memset(stream, 0, sizeof(lz4_stream_t));
+
+    stream->dst = (uint8_t *)dst;
+    stream->out = stream->dst;
+    stream->end = stream->dst + size;
+    stream->frame = stream->dst;
+    lz4_collect(stream, LZ4_STATE_MAGIC, 4);
+}
+
+/**
+ * lz4_stream_write Implementation (See header file for description)
+*/
+int32_t lz4_stream_write(lz4_stream_t* stream, const void* src, uint32_t len)
+{
+    lz4_stream_t *s = stream;
+    const uint8_t *ip = (const uint8_t *)src;
+    const uint8_t *iend = ip + len;
+    const uint8_t *block = ((lz4_block_hashed(s)) ? (ip) : (NULL));   /* Start of the block data to hash */
+    int32_t ret = E_OK;
+
+    while(ip < iend && ret == E_OK)
+    {
+        uint32_t avail = iend - ip;
+
+        switch(s->state)
+        {
+        case LZ4_STATE_MAGIC:
+        case LZ4_STATE_SKIP_SIZE:
+        case LZ4_STATE_DESCRIPTOR:
+        case LZ4_STATE_BLOCK_SIZE:
+        case LZ4_STATE_OFFSET:
+        case LZ4_STATE_BLOCK_CHECKSUM:
+        case LZ4_STATE_CONTENT_CHECKSUM:
+        {
+            uint32_t n = min(s->need - s->count, avail);
+
+            if(s->state == LZ4_STATE_OFFSET)
+            {
+                if(n > s->blockLeft)
+                {
+                    ret = E_ERROR;
+                    break;
+                }
+                s->blockLeft -= n;
+            }
+
+            memcpy(&s->field[s->count], ip, n);
+            s->count += n;
+            ip += n;
+
+            if(s->count == s->need)
+            {
+                ret = lz4_field(s);
+            }
+            break;
+        }
+        case LZ4_STATE_SKIP:
+        {
+            uint32_t n = min(s->skip, avail);
+
+            ip += n;
+            s->skip -= n;
+            if(s->skip == 0)
+            {
+                lz4_collect(s, LZ4_STATE_MAGIC, 4);
+            }
+            break;
+        }
+        case LZ4_STATE_TOKEN:
+        {
+            uint8_t token = *ip++;
+
+            s->blockLeft--;
+            s->litLen = token >> 4;
+            s->matchLen = token & 0xF;
+            s->state = ((s->litLen == 15) ? (LZ4_STATE_LITLEN) : (LZ4_STATE_LITERALS));
+            break;
+        }
+        case LZ4_STATE_LITLEN:
+        case LZ4_STATE_MATCHLEN:
+        {
+            uint8_t b = *ip++;
+
+            if(s->blockLeft == 0)
+            {
+                ret = E_ERROR;
+                break;
+            }
+            s->blockLeft--;
+
+            if(s->state == LZ4_STATE_LITLEN)
+            {
+                s->litLen += b;
+                if(b != 255)
+                {
+                    s->state = LZ4_STATE_LITERALS;
+                }
+            }
+            else
+            {
+                s->matchLen += b;
+                if(b != 255)
+                {
+                    ret = lz4_match(s, s->offset);
+                }
+            }
+            break;
+        }
+        case LZ4_STATE_LITERALS:
+        case LZ4_STATE_RAW:
+        {
+            uint32_t want = ((s->state == LZ4_STATE_RAW) ? (s->blockLeft) : (s->litLen));
+            uint32_t n = min(want, avail);
+
+            if(n > s->blockLeft)
+            {
+                ret = E_ERROR;
+                break;
+            }
+            if(n > (uint32_t)(s->end - s->out))
+            {
+                ret = E_NO_MEMORY;
+                break;
+            }
+
+            memcpy(s->out, ip, n);
+            s->out += n;
+            ip += n;
+            s->blockLeft -= n;
+
+            if(s->state == LZ4_STATE_LITERALS)
+            {
+                s->litLen -= n;
+                if(s->litLen != 0)
+                {
+                    break;
+                }
+                if(s->blockLeft == 0)
+                {
+                    /* Last sequence of the block has no match */
+                    lz4_block_end(s);
+                }
+                else
+                {
+                    lz4_collect(s, LZ4_STATE_OFFSET, 2);
+                }
+            }
+            else if(s->blockLeft == 0)
+            {
+                lz4_block_end(s);
+            }
+            break;
+        }
+        default:
+            ret = E_ERROR;
+            break;
+        }
+
+        /* Hash the block data in one piece per call, from its start (or the
+         * start of the call) to its end (or the end of the call) */
+        if(block != NULL)
+        {
+            if(!lz4_block_hashed(s))
+            {
+                lz4_xxh32_update(&s->blockHash, block, ip - block);
+                block = NULL;
+            }
+        }
+        else if(lz4_block_hashed(s))
+        {
+            block = ip;
+        }
+    }
+
+    if(block != NULL)
+    {
+        lz4_xxh32_update(&s->blockHash, block, ip - block);
+    }
+
+    if(ret != E_OK)
+    {
+        s->state = LZ4_STATE_ERROR;
+    }
+
+    return ret;
+}
+
+/**
+ * lz4_stream_finish Implementation (See header file for description)
+*/
+int32_t lz4_stream_finish(lz4_stream_t* stream, uint32_t* size)
+{
+    uint32_t i;
+
+    *size = stream->out - stream->dst;
+
+    if(stream->state != LZ4_STATE_MAGIC || stream->frames == 0)
+    {
+        return E_ERROR;
+    }
+
+    for(i = 0; i < stream->count; i++)
+    {
+        if(stream->field[i] != 0)
+        {
+            return E_ERROR;
+        }
+    }
+
+    return E_OK;
+}
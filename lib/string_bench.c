@@ -0,0 +1,119 @@
+/**
+ * @file        string_bench.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       String functions microbenchmark (bytes/cycle per size class)
+*/
+
+#ifdef CONFIG_STRING_BENCH
+
+/* Includes ----------------------------------------------- */
+#include <string.h>
+#include <pmu.h>
+#include <dram.h>
+#include <serial.h>
+#include <helper.h>
+
+
+/* Private types ------------------------------------------ */
+
+typedef enum
+{
+    benchMemcpy,
+    benchMemcpyUnaligned,
+    benchMemset,
+    benchMemcmp,
+}bench_t;
+
+
+/* Private constants -------------------------------------- */
+
+#define BENCH_SRC           ((uint8_t*)(DRAM_BASE + 0x08000000))
+#define BENCH_DST           ((uint8_t*)(DRAM_BASE + 0x09000000))
+#define BENCH_TOTAL_BYTES   (0x100000)  // Bytes moved per size class
+
+
+/* Private macros ----------------------------------------- */
+
+
+
+/* Private variables -------------------------------------- */
+
+static const uint32_t BenchSizes[] = {16, 64, 256, 1024, 4096, 65536, 1048576};
+
+static const char* BenchNames[] = {"memcpy   ", "memcpy+1 ", "memset   ", "memcmp   "};
+
+
+/* Private function prototypes ---------------------------- */
+
+static uint32_t StringBenchRun(bench_t bench, uint32_t size)
+{
+    uint32_t loops = ((size < BENCH_TOTAL_BYTES) ? (BENCH_TOTAL_BYTES / size) : (1));
+    uint32_t cycles, i;
+
+    PERFORMANCE_MONITORING_START(cycles);
+    for(i = 0; i < loops; ++i)
+    {
+        switch(bench)
+        {
+        case benchMemcpy:
+            memcpy(BENCH_DST, BENCH_SRC, size);
+            break;
+        case benchMemcpyUnaligned:
+            memcpy(BENCH_DST, BENCH_SRC + 1, size);
+            break;
+        case benchMemset:
+            memset(BENCH_DST, 0x5A, size);
+            break;
+        case benchMemcmp:
+            (void)memcmp(BENCH_DST, BENCH_SRC, size);
+            break;
+        }
+    }
+    PERFORMANCE_MONITORING_STOP(cycles);
+
+    // Bytes per cycle in thousandths
+    return (uint32_t)(((uint64_t)loops * size * 1000) / ((cycles) ? (cycles) : (1)));
+}
+
+static void StringBenchPrint(bench_t bench, uint32_t size, uint32_t result)
+{
+    char str[11];
+    uint32_t frac = result % 1000;
+
+    puts(BenchNames[bench]);
+    puts(itoa(size, str, 10));
+    puts(": ");
+    puts(itoa(result / 1000, str, 10));
+    puts(".");
+    if(frac < 100) puts("0");
+    if(frac < 10) puts("0");
+    puts(itoa(frac, str, 10));
+    puts(" B/cycle\n");
+}
+
+
+/* Private functions -------------------------------------- */
+
+void StringBench(void)
+{
+    uint32_t bench, i;
+
+    puts("String functions benchmark:\n");
+
+    // Same contents so memcmp walks the full size
+    memset(BENCH_SRC, 0x5A, BenchSizes[(sizeof(BenchSizes) / sizeof(BenchSizes[0])) - 1] + 1);
+
+    for(bench = benchMemcpy; bench <= benchMemcmp; ++bench)
+    {
+        for(i = 0; i < (sizeof(BenchSizes) / sizeof(BenchSizes[0])); ++i)
+        {
+            if(bench == benchMemcmp) memset(BENCH_DST, 0x5A, BenchSizes[i]);
+
+            StringBenchPrint(bench, BenchSizes[i], StringBenchRun(bench, BenchSizes[i]));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Send only the blocks of an image that differ from the target memory.
+
+Usage: delta_load.py port addr file [baud]
+
+Drives the bootloader 'load serial-delta' command. The target reports the
+crc32 of every block at addr, the host answers with a bitmap of the blocks
+that changed and sends those with the framed protocol (see app/xfer.h and
+frame_load.py). The whole image crc32 is still checked at the end.
+"""
+
+import struct
+import sys
+import time
+import zlib
+
+from frame_load import (ACK, HASHES, MAP, NAK, PAYLOAD, TIMEOUT, Replies,
+                        packet, send_data, start_packet)
+from serial_load import CONSOLE_BAUD, open_port, switch_baud, wait_for
+
+
+def get_hashes(port, replies, image):
+    start = start_packet(image)
+    for _ in range(20):
+        port.write(start)
+        reply = replies.get(TIMEOUT)
+        if not reply or reply[0] != HASHES:
+            continue
+        _, block_size, count = reply
+        # 12 bytes per block over the wire, allow for slow links
+        raw = replies.read(count * 4 + 4, TIMEOUT + count * 0.001)
+        if raw is None:
+            continue
+        hashes = raw[:-4]
+        (crc,) = struct.unpack("<I", raw[-4:])
+        if zlib.crc32(hashes) & 0xFFFFFFFF != crc:
+            continue
+        return block_size, struct.unpack("<%dI" % count, hashes)
+    sys.exit("no block hashes from the target")
+
+
+def send_map(port, replies, changed):
+    bitmap = bytearray(PAYLOAD)
+    for block in changed:
+        bitmap[block >> 3] |= 1 << (block & 7)
+    for _ in range(20):
+        port.write(packet(MAP, 0, bytes(bitmap)))
+        reply = replies.get(TIMEOUT)
+        if reply and reply[0] == ACK:
+            return reply[1]
+    sys.exit("no answer to MAP")
+
+
+def main():
+    if len(sys.argv) not in (4, 5):
+        sys.exit(__doc__)
+
+    dev, addr, path = sys.argv[1:4]
+    baud = int(sys.argv[4]) if len(sys.argv) == 5 else 0
+
+    with open(path, "rb") as f:
+        image = f.read()
+
+    port = open_port(dev)
+    port.reset_input_buffer()
+    cmd = "load serial-delta %s" % addr
+    if baud:
+        cmd += " %d" % baud
+    port.write(cmd.encode() + b"\r")
+
+    switched = switch_baud(port, baud)
+    wait_for(port, b"Waiting for delta transfer\r\n")
+
+    begin = time.time()
+    replies = Replies(port)
+    block_size, hashes = get_hashes(port, replies, image)
+    changed = [i for i, h in enumerate(hashes)
+               if zlib.crc32(image[i * block_size:(i + 1) * block_size])
+               & 0xFFFFFFFF != h]
+    base = send_map(port, replies, changed)
+
+    per_block = block_size // PAYLOAD
+    todo = [b * per_block + i for b in changed for i in range(per_block)]
+    total = (len(image) + PAYLOAD - 1) // PAYLOAD
+    todo = [seq for seq in todo if seq < total]
+    resent = send_data(port, replies, image, todo, base)
+    elapsed = time.time() - begin
+
+    if switched:
+        time.sleep(0.05)
+        port.baudrate = CONSOLE_BAUD
+    print("%d of %d blocks of %d bytes changed, sent in %.2f s, %d packets resent"
+          % (len(changed), len(hashes), block_size, elapsed, resent))
+    port.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Send a file to the bootloader 'load frame' command.
+
+Usage: frame_load.py port addr file [baud]
+
+port is a serial device, a pty or a pyserial URL such as socket://host:port
+(QEMU -serial tcp::4444,server). The packet format is documented in
+app/xfer.h: fixed size packets with crc32, up to WINDOW packets in flight,
+selective retransmission on NAK or timeout and a final image crc32 check.
+"""
+
+import struct
+import sys
+import time
+import zlib
+
+from serial_load import CONSOLE_BAUD, open_port, switch_baud, wait_for
+
+SYNC_HOST = 0xA5
+SYNC_TARGET = 0x5A
+START, DATA, END, MAP = 0x01, 0x02, 0x03, 0x04
+ACK, NAK, DONE, FAIL, HASHES = 0x10, 0x11, 0x12, 0x13, 0x14
+PAYLOAD = 1024
+WINDOW = 16
+REPLY_SIZE = 12
+TIMEOUT = 1.0
+
+
+def packet(ptype, seq, data=b""):
+    body = struct.pack("<BBHI", SYNC_HOST, ptype, len(data), seq)
+    body += data + b"\0" * (PAYLOAD - len(data))
+    return body + struct.pack("<I", zlib.crc32(body) & 0xFFFFFFFF)
+
+
+class Replies:
+    """Pull target replies out of the byte stream, skipping console text."""
+
+    def __init__(self, port):
+        self.port = port
+        self.buf = b""
+
+    def _fill(self):
+        self.buf += self.port.read(max(1, self.port.in_waiting))
+
+    def get(self, timeout):
+        """Return (type, value, count) or None on timeout."""
+        end = time.time() + timeout
+        while True:
+            i = self.buf.find(bytes([SYNC_TARGET]))
+            if i < 0:
+                self.buf = b""
+            else:
+                self.buf = self.buf[i:]
+                if len(self.buf) >= REPLY_SIZE:
+                    frame = self.buf[:REPLY_SIZE]
+                    _, rtype, count, value, crc = struct.unpack("<BBHII", frame)
+                    if zlib.crc32(frame[:8]) & 0xFFFFFFFF == crc:
+                        self.buf = self.buf[REPLY_SIZE:]
+                        return rtype, value, count
+                    self.buf = self.buf[1:]
+                    continue
+            if time.time() > end:
+                return None
+            self._fill()
+
+    def read(self, size, timeout):
+        """Raw bytes following a reply, None on timeout."""
+        end = time.time() + timeout
+        while len(self.buf) < size:
+            if time.time() > end:
+                return None
+            self._fill()
+        data, self.buf = self.buf[:size], self.buf[size:]
+        return data
+
+
+def start_packet(image):
+    return packet(START, 0, struct.pack("<II", len(image),
+                                        zlib.crc32(image) & 0xFFFFFFFF))
+
+
+def send_data(port, replies, image, todo, base=0):
+    """Send the packets in todo (sorted) within the target window.
+
+    Returns the number of packets sent again."""
+    total = (len(image) + PAYLOAD - 1) // PAYLOAD
+
+    def data(seq):
+        port.write(packet(DATA, seq, image[seq * PAYLOAD:(seq + 1) * PAYLOAD]))
+
+    pos = 0
+    resent = 0
+    while base < total:
+        while pos < len(todo) and todo[pos] < base + WINDOW:
+            if todo[pos] >= base:
+                data(todo[pos])
+            pos += 1
+        reply = replies.get(TIMEOUT)
+        if reply is None:
+            data(base)
+            resent += 1
+            continue
+        rtype, value, _ = reply
+        if rtype == ACK:
+            base = max(base, value)
+        elif rtype == NAK and base <= value < total:
+            data(value)
+            resent += 1
+        elif rtype == FAIL:
+            sys.exit("transfer rejected")
+
+    for _ in range(20):
+        port.write(packet(END, total))
+        reply = replies.get(TIMEOUT)
+        while reply and reply[0] == ACK:
+            reply = replies.get(TIMEOUT)
+        if reply is None:
+            continue
+        rtype, value, _ = reply
+        if rtype == DONE:
+            return resent
+        if rtype == FAIL:
+            sys.exit("image crc mismatch (target 0x%08x)" % value)
+        if rtype == NAK and value < total:
+            data(value)
+            resent += 1
+    sys.exit("no answer to END")
+
+
+def send(port, image):
+    total = (len(image) + PAYLOAD - 1) // PAYLOAD
+    replies = Replies(port)
+
+    start = start_packet(image)
+    for _ in range(20):
+        port.write(start)
+        reply = replies.get(TIMEOUT)
+        if reply and reply[0] == ACK:
+            break
+    else:
+        sys.exit("no answer to START")
+
+    return send_data(port, replies, image, list(range(total)))
+
+
+def main():
+    if len(sys.argv) not in (4, 5):
+        sys.exit(__doc__)
+
+    dev, addr, path = sys.argv[1:4]
+    baud = int(sys.argv[4]) if len(sys.argv) == 5 else 0
+
+    with open(path, "rb") as f:
+        image = f.read()
+
+    port = open_port(dev)
+    port.reset_input_buffer()
+    cmd = "load frame %s" % addr
+    if baud:
+        cmd += " %d" % baud
+    port.write(cmd.encode() + b"\r")
+
+    switched = switch_baud(port, baud)
+    wait_for(port, b"Waiting for framed transfer\r\n")
+
+    begin = time.time()
+    resent = send(port, image)
+    elapsed = time.time() - begin
+
+    if switched:
+        time.sleep(0.05)
+        port.baudrate = CONSOLE_BAUD
+    print("sent %d bytes in %.2f s (%.1f KiB/s), %d packets resent"
+          % (len(image), elapsed, len(image) / 1024.0 / max(elapsed, 1e-6),
+             resent))
+    port.close()
+
+
+if __name__ == "__main__":
+    main()
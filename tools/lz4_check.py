@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""Check the bootloader LZ4 decoder (lib/lz4.c) against the lz4 command line tool.
+
+Usage: lz4_check.py [-v]
+
+Builds lib/lz4.c and tools/lz4_host.c with the host gcc, compresses a set of
+test files with lz4 and checks that the decoder gives the original data back:
+compression levels, block sizes (-B4..-B7), linked and independent blocks
+(-BD), block checksums (-BX), content size and checksum, concatenated and
+skippable frames, input split at random points, corrupted and truncated
+frames and output that does not fit. Needs gcc and lz4 in the PATH.
+"""
+
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Error codes from include/types.h
+E_OK = 0
+E_NO_MEMORY = 8
+E_ERROR = 10
+
+OPTIONS = [
+    ["-1"],
+    ["-9"],
+    ["-12"],
+    ["-B4"],
+    ["-B5"],
+    ["-B6"],
+    ["-B7"],
+    ["-B4", "-BD"],
+    ["-B4", "-BX"],
+    ["-B4", "-BD", "-BX", "-9"],
+    ["--content-size"],
+    ["--no-frame-crc"],
+    ["--no-frame-crc", "--content-size", "-BX", "-12"],
+]
+
+SPLITS = [0, 1, 7, 4099]
+
+verbose = False
+
+
+def make_data():
+    rnd = random.Random(0x4C5A34)
+    words = [b"bootloader", b"sunxi", b"cluster", b"sector", b"0x4FD00000", b"\n", b" "]
+    text = b"".join(rnd.choice(words) for _ in range(60000))
+    noise = bytes(rnd.getrandbits(8) for _ in range(200000))
+    return {
+        "empty": b"",
+        "byte": b"A",
+        "short": b"abcabcabcabc" * 5 + b"xyz",
+        "text": text,
+        "noise": noise,
+        "zeros": bytes(1 << 20),
+        "mixed": text * 8 + noise + bytes(300000) + text[:12345],
+    }
+
+
+def build(tmp):
+    obj = os.path.join(tmp, "lz4.o")
+    exe = os.path.join(tmp, "lz4_host")
+    subprocess.check_call(["gcc", "-O2", "-Wall", "-Werror", "-ffreestanding", "-nostdinc",
+                           "-I" + os.path.join(ROOT, "include"),
+                           "-I" + os.path.join(ROOT, "arch", "include"),
+                           "-c", os.path.join(ROOT, "lib", "lz4.c"), "-o", obj])
+    subprocess.check_call(["gcc", "-O2", "-std=c99", "-Wall", "-Werror",
+                           "-idirafter", os.path.join(ROOT, "include"),
+                           os.path.join(ROOT, "tools", "lz4_host.c"), obj, "-o", exe])
+    return exe
+
+
+def compress(tmp, data, options):
+    src = os.path.join(tmp, "in.bin")
+    with open(src, "wb") as f:
+        f.write(data)
+    return subprocess.check_output(["lz4", "-q", "-c"] + options + [src])
+
+
+def decode(exe, tmp, frame, chunk=0, limit=None):
+    src = os.path.join(tmp, "in.lz4")
+    dst = os.path.join(tmp, "out.bin")
+    with open(src, "wb") as f:
+        f.write(frame)
+    args = [exe, src, dst, str(chunk)]
+    if limit is not None:
+        args.append(str(limit))
+    fields = subprocess.check_output(args).split()
+    with open(dst, "rb") as f:
+        out = f.read()
+    return int(fields[1]), int(fields[3]), out
+
+
+class Checker:
+    def __init__(self):
+        self.passed = 0
+        self.failed = 0
+
+    def check(self, name, ok):
+        if ok:
+            self.passed += 1
+        else:
+            self.failed += 1
+            print("FAIL " + name)
+        if verbose and ok:
+            print("ok   " + name)
+
+
+def skippable(payload, nibble=0):
+    return struct.pack("<II", 0x184D2A50 | nibble, len(payload)) + payload
+
+
+def main():
+    global verbose
+    verbose = "-v" in sys.argv[1:]
+
+    for tool in ("gcc", "lz4"):
+        if shutil.which(tool) is None:
+            sys.exit("%s not found" % tool)
+
+    c = Checker()
+    data = make_data()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(tmp)
+
+        # Round trips, whole input and split at random points
+        for name, raw in data.items():
+            for options in OPTIONS:
+                frame = compress(tmp, raw, options)
+                for chunk in SPLITS:
+                    if chunk == 1 and len(frame) > 100000:
+                        continue
+                    w, f, out = decode(exe, tmp, frame, chunk)
+                    c.check("%s %s split %d" % (name, " ".join(options), chunk),
+                            w == E_OK and f == E_OK and out == raw)
+
+        # Several frames, skippable frames and zero padding in one stream
+        text = data["text"]
+        stream = (compress(tmp, text[:5000], ["-9"]) + skippable(b"meta" * 10, 0x7) +
+                  compress(tmp, text[5000:], ["-BX", "--content-size"]) + bytes(3))
+        for chunk in SPLITS:
+            w, f, out = decode(exe, tmp, stream, chunk)
+            c.check("concatenated split %d" % chunk, w == E_OK and f == E_OK and out == text)
+
+        # Corrupted data has to be caught by the block or content checksum
+        raw = data["mixed"]
+        for options in (["-B4", "-BX"], ["-B4"], ["-B4", "-BD", "-BX", "--no-frame-crc"]):
+            frame = bytearray(compress(tmp, raw, options))
+            rnd = random.Random(len(frame))
+            for _ in range(8):
+                bad = bytearray(frame)
+                bad[rnd.randrange(16, len(bad) - 8)] ^= 1 << rnd.randrange(8)
+                w, f, out = decode(exe, tmp, bytes(bad), 4099)
+                c.check("corrupted %s" % " ".join(options), w != E_OK or f != E_OK)
+
+        # A bad descriptor checksum, frame version or reserved bits
+        frame = compress(tmp, text, [])
+        for offset, mask in ((4, 0x80), (5, 0x01), (6, 0xff)):
+            bad = bytearray(frame)
+            bad[offset] ^= mask
+            w, f, out = decode(exe, tmp, bytes(bad))
+            c.check("bad descriptor byte %d" % offset, w == E_ERROR or f == E_ERROR)
+
+        # Truncated anywhere
+        frame = compress(tmp, text, ["-B4", "-BX"])
+        rnd = random.Random(1)
+        for cut in [1, 4, 6, 7, 10, len(frame) - 4, len(frame) - 1] + rnd.sample(range(11, len(frame) - 4), 10):
+            w, f, out = decode(exe, tmp, frame[:cut], 7)
+            c.check("truncated at %d" % cut, w == E_OK and f == E_ERROR)
+
+        # Output that does not fit, with and without the content size
+        for options in ([], ["--content-size"]):
+            frame = compress(tmp, text, options)
+            w, f, out = decode(exe, tmp, frame, 4099, len(text) - 1)
+            c.check("output limit %s" % " ".join(options), w == E_NO_MEMORY)
+            w, f, out = decode(exe, tmp, frame, 4099, len(text))
+            c.check("exact output limit %s" % " ".join(options), w == E_OK and f == E_OK and out == text)
+
+        # Legacy frames are not supported
+        legacy = subprocess.check_output(["lz4", "-q", "-c", "-l", os.path.join(tmp, "in.bin")])
+        w, f, out = decode(exe, tmp, legacy)
+        c.check("legacy frame rejected", w == E_ERROR)
+
+    print("%d passed, %d failed" % (c.passed, c.failed))
+    return 1 if c.failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
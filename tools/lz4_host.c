@@ -0,0 +1,109 @@
+/**
+ * @file        lz4_host.c
+ * @author      Carlos Fernandes
+ * @version     1.0
+ * @date        17 October, 2026
+ * @brief       Host driver for lib/lz4.c, used by tools/lz4_check.py.
+ *
+ *              Usage: lz4_host in out [chunk [limit]]
+ *
+ *              Feeds the frame in to the decoder in pieces of 1 to chunk
+ *              bytes (0: all at once) and writes the decoded data to out.
+ *              limit is the output buffer size. Prints the results of
+ *              lz4_stream_write and lz4_stream_finish and the output size.
+*/
+
+/* Includes ----------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lz4.h>
+
+
+/* Private constants -------------------------------------- */
+#define LZ4_HOST_LIMIT      (256 << 20)
+
+
+/* Private functions -------------------------------------- */
+
+static uint8_t* LoadFile(const char* path, uint32_t* size)
+{
+    FILE* f = fopen(path, "rb");
+    if(f == NULL)
+    {
+        return NULL;
+    }
+
+    (void)fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    (void)fseek(f, 0, SEEK_SET);
+
+    uint8_t* data = malloc((len > 0) ? ((size_t)len) : (1));
+    if(data == NULL || fread(data, 1, (size_t)len, f) != (size_t)len)
+    {
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+    fclose(f);
+
+    *size = (uint32_t)len;
+
+    return data;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3 || argc > 5)
+    {
+        fprintf(stderr, "usage: lz4_host in out [chunk [limit]]\n");
+        return 2;
+    }
+
+    uint32_t chunk = ((argc > 3) ? ((uint32_t)strtoul(argv[3], NULL, 0)) : (0));
+    uint32_t limit = ((argc > 4) ? ((uint32_t)strtoul(argv[4], NULL, 0)) : (LZ4_HOST_LIMIT));
+    uint32_t size = 0;
+
+    uint8_t* in = LoadFile(argv[1], &size);
+    uint8_t* out = malloc((limit > 0) ? (limit) : (1));
+    if(in == NULL || out == NULL)
+    {
+        fprintf(stderr, "lz4_host: can not read %s\n", argv[1]);
+        return 2;
+    }
+
+    lz4_stream_t lz4;
+    lz4_stream_init(&lz4, out, limit);
+
+    // Random split points, the same for every run with the same chunk
+    srand(chunk);
+
+    int32_t writeRet = E_OK;
+    uint32_t pos = 0;
+    while(pos < size && writeRet == E_OK)
+    {
+        uint32_t len = ((chunk != 0) ? (((uint32_t)rand() % chunk) + 1) : (size - pos));
+        if(len > (size - pos)) len = size - pos;
+
+        writeRet = lz4_stream_write(&lz4, &in[pos], len);
+        pos += len;
+    }
+
+    uint32_t outSize = 0;
+    int32_t finishRet = lz4_stream_finish(&lz4, &outSize);
+
+    FILE* f = fopen(argv[2], "wb");
+    if(f == NULL || fwrite(out, 1, outSize, f) != outSize)
+    {
+        fprintf(stderr, "lz4_host: can not write %s\n", argv[2]);
+        return 2;
+    }
+    fclose(f);
+
+    printf("write %d finish %d size %u\n", (int)writeRet, (int)finishRet, outSize);
+
+    free(in);
+    free(out);
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Send a file to the bootloader 'load serial' command.
+
+Usage: serial_load.py port addr file [baud]
+
+Without baud the file is sent at the console baudrate (115200). With baud the
+bootloader announces the switch, both sides change baudrate, the host sends
+'S' until it reads 'A', then sends 'G' followed by the data. The bootloader
+restores the console baudrate when the transfer is done.
+"""
+
+import sys
+import time
+
+import serial
+
+CONSOLE_BAUD = 115200
+
+
+def wait_for(port, text, timeout=5.0):
+    data = b""
+    end = time.time() + timeout
+    while time.time() < end:
+        data += port.read(1)
+        if data.endswith(text):
+            return data
+    raise RuntimeError("timeout waiting for %r, got %r" % (text, data))
+
+
+def open_port(dev):
+    """Open a serial device, pty or pyserial URL (e.g. socket://host:port)."""
+    return serial.serial_for_url(dev, CONSOLE_BAUD, timeout=0.1)
+
+
+def switch_baud(port, baud):
+    """Follow the bootloader to baud once it announced the switch."""
+    if not baud or baud == CONSOLE_BAUD:
+        return False
+    wait_for(port, b" baud\r\n")
+    time.sleep(0.01)
+    port.baudrate = baud
+    port.reset_input_buffer()
+    end = time.time() + 5.0
+    while port.read(1) != b"A":
+        if time.time() > end:
+            sys.exit("no ack at %d baud" % baud)
+        port.write(b"S")
+    port.write(b"G")
+    return True
+
+
+def main():
+    if len(sys.argv) not in (4, 5):
+        sys.exit(__doc__)
+
+    dev, addr, path = sys.argv[1:4]
+    baud = int(sys.argv[4]) if len(sys.argv) == 5 else 0
+
+    with open(path, "rb") as f:
+        image = f.read()
+    # The bootloader receives whole words
+    image += b"\0" * (-len(image) % 4)
+
+    port = open_port(dev)
+    port.reset_input_buffer()
+    cmd = "load serial %s %d" % (addr, len(image))
+    if baud:
+        cmd += " %d" % baud
+    port.write(cmd.encode() + b"\r")
+
+    switched = switch_baud(port, baud)
+
+    start = time.time()
+    port.write(image)
+    port.flush()
+    elapsed = time.time() - start
+
+    if switched:
+        # Let the last '=' arrive before going back
+        time.sleep(0.05)
+        port.baudrate = CONSOLE_BAUD
+    print("sent %d bytes in %.2f s (%.1f KiB/s)"
+          % (len(image), elapsed, len(image) / 1024.0 / max(elapsed, 1e-6)))
+    port.close()
+
+
+if __name__ == "__main__":
+    main()